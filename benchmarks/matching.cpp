@@ -0,0 +1,453 @@
+//  matchingR -- Matching Algorithms in R and C++
+//
+//  Copyright (C) 2015  Jan Tilly <jtilly@econ.upenn.edu>
+//                      Nick Janetos <njanetos@econ.upenn.edu>
+//
+//  This file is part of matchingR.
+//
+//  matchingR is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation, either version 2 of the License, or
+//  (at your option) any later version.
+//
+//  matchingR is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+
+// Measures the running time and memory use of the Gale-Shapley, Irving, and
+// top trading cycle algorithms across market sizes. The benchmark uses the
+// header-only algorithms in inst/include/matchingR and does not need R. Build
+// and run it from the root of the repository with
+//
+//   c++ -O2 -std=c++11 -fopenmp -I inst/include benchmarks/matching.cpp -o matching-benchmark
+//   ./matching-benchmark --sizes 100,1000,10000 > results.csv
+//
+// The speedup curve of the parallel Gale-Shapley algorithm is measured with
+//
+//   ./matching-benchmark --algorithms galeshapley-parallel --threads 1,2,4,8,16
+//
+// Options (defaults in brackets):
+//
+//   --algorithms   galeshapley,galeshapley-parallel,irving,ttc   [all four]
+//   --threads      numbers of threads of galeshapley-parallel   [1, 2, 4, ...
+//                  up to the number of cores]
+//   --generators   uniform,correlated,master,adversarial   [all four]
+//   --sizes        number of agents on each side   [100,1000,10000,100000]
+//   --replications number of timed runs per market, the fastest is reported [3]
+//   --seed         seed of the workload generators [1]
+//   --max-memory   largest size of the tables in bytes; larger markets are
+//                  reported as skipped [8e9]
+//   --format       csv or json (one object per line) [csv]
+//
+// Workloads:
+//
+//   uniform      every agent ranks the other side in a random order
+//   correlated   payoffs are the sum of a common quality of each partner and
+//                idiosyncratic noise of the same size
+//   master       every agent ranks the other side in the same order
+//   adversarial  proposers share a master list and reviewers prefer proposers
+//                in the reverse order in which they start proposing, so that
+//                deferred acceptance makes n(n+1)/2 proposals and every
+//                proposal but the last to each reviewer is later rejected.
+//                Roommate and top trading cycle markets use the master list.
+//
+// ns_per_entry is the running time in nanoseconds divided by n^2. Deferred
+// acceptance, the top trading cycle algorithm, and phase 1 of Irving's
+// algorithm run in O(n^2) time, so it should not grow with n (apart from
+// cache effects) for these, including the adversarial workload. Phase 2 of
+// Irving's algorithm eliminates rotations in the order of the original
+// implementation and only reuses its search path when that order allows it.
+//
+// The status of a market is ok, no_solution (a roommate market without a
+// stable matching), skipped, or failed. Each market is generated and solved in
+// a child process, so that the peak resident set size (from wait4) covers that
+// market only. It is reported in kilobytes on Linux and in bytes on macOS.
+// The speedup of galeshapley-parallel is relative to the first number of
+// threads that is benchmarked for the same market. Without OpenMP, it runs on
+// one thread.
+// Preference tables are stored with 16-bit indices if the market allows it and
+// with 32-bit indices otherwise. Dense tables take n^2 entries, so markets with
+// 10^5 agents on each side need tens of gigabytes and are skipped unless
+// --max-memory allows them.
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <sys/resource.h>
+#include <sys/time.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+#include <matchingR/galeshapley.h>
+#include <matchingR/roommate.h>
+#include <matchingR/toptradingcycle.h>
+
+using matchingR::Matrix;
+
+struct Options {
+    std::vector<std::string> algorithms, generators;
+    std::vector<std::size_t> sizes, threads;
+    std::size_t replications;
+    unsigned long seed;
+    double maxMemory;
+    std::string format;
+};
+
+// result of a single market, computed in the child process
+struct Result {
+    double seconds;
+    double proposals;
+    bool solved;
+};
+
+static std::vector<std::string> splitList(const std::string& s) {
+    std::vector<std::string> out;
+    std::stringstream ss(s);
+    std::string item;
+    while (std::getline(ss, item, ',')) {
+        if (!item.empty()) {
+            out.push_back(item);
+        }
+    }
+    return out;
+}
+
+// Fills column j of pref with j's preferences over the candidates 0, ...,
+// nCandidates - 1 (skipping j itself if skipSelf is true). quality is the
+// common component of the payoffs and the master list of the market.
+template <typename Index>
+void fillPreferences(Matrix<Index>& pref, const std::size_t nCandidates, const bool skipSelf,
+                     const std::string& generator, const bool reverse,
+                     const std::vector<double>& quality, std::mt19937_64& rng) {
+
+    const std::size_t nCols = pref.n_cols;
+    std::vector<std::size_t> order(nCandidates);
+    std::vector<double> payoff(nCandidates);
+    std::uniform_real_distribution<double> unif(0.0, 1.0);
+
+    for (std::size_t j = 0; j < nCols; j++) {
+        for (std::size_t c = 0; c < nCandidates; c++) {
+            order[c] = c;
+        }
+        if (generator == "uniform") {
+            std::shuffle(order.begin(), order.end(), rng);
+        } else {
+            for (std::size_t c = 0; c < nCandidates; c++) {
+                payoff[c] = generator == "correlated" ? quality[c] + unif(rng) : quality[c];
+            }
+            if (reverse) {
+                for (std::size_t c = 0; c < nCandidates; c++) {
+                    payoff[c] = -payoff[c];
+                }
+            }
+            std::sort(order.begin(), order.end(), [&](const std::size_t a, const std::size_t b) {
+                return payoff[a] > payoff[b] || (payoff[a] == payoff[b] && a < b);
+            });
+        }
+        std::size_t i = 0;
+        for (std::size_t c = 0; c < nCandidates; c++) {
+            if (!(skipSelf && order[c] == j)) {
+                pref(i++, j) = static_cast<Index>(order[c]);
+            }
+        }
+    }
+}
+
+// the common quality of each agent; in the adversarial market of the
+// Gale-Shapley algorithm, reviewers rank proposers by their index instead
+static std::vector<double> generateQuality(const std::size_t n, const std::string& generator, std::mt19937_64& rng) {
+    std::vector<double> quality(n);
+    std::uniform_real_distribution<double> unif(0.0, 1.0);
+    for (std::size_t i = 0; i < n; i++) {
+        quality[i] = generator == "adversarial" ? static_cast<double>(n - i) : unif(rng);
+    }
+    return quality;
+}
+
+template <typename Index>
+Result runGaleShapley(const std::size_t n, const std::string& generator, const bool parallel, const Options& options) {
+
+    std::mt19937_64 rng(options.seed);
+
+    // proposerPref is n by n with the preferences of the proposers, reviewerRanks
+    // is n by n with the rank of each proposer in each reviewer's preferences
+    Matrix<Index> proposerPref, reviewerPref, reviewerRanks;
+    proposerPref.set_size(n, n);
+    reviewerPref.set_size(n, n);
+    fillPreferences(proposerPref, n, false, generator, false, generateQuality(n, generator, rng), rng);
+    fillPreferences(reviewerPref, n, false, generator, generator == "adversarial", generateQuality(n, generator, rng), rng);
+    reviewerRanks.set_size(n, n);
+    for (std::size_t j = 0; j < n; j++) {
+        for (std::size_t i = 0; i < n; i++) {
+            reviewerRanks(reviewerPref(i, j), j) = static_cast<Index>(i);
+        }
+    }
+    reviewerPref = Matrix<Index>();
+
+    std::vector<std::size_t> proposals(n), engagements(n);
+    matchingR::GaleShapleyScratch scratch;
+    Result result = {1e300, 0, true};
+    for (std::size_t r = 0; r < options.replications; r++) {
+        const auto start = std::chrono::steady_clock::now();
+        result.proposals = static_cast<double>(parallel
+            ? matchingR::galeShapleyMatchingParallel(proposerPref, reviewerRanks, proposals.begin(), engagements.begin(), scratch)
+            : matchingR::galeShapleyMatchingOrdinal(proposerPref, reviewerRanks, proposals.begin(), engagements.begin(), scratch));
+        const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+        result.seconds = std::min(result.seconds, elapsed.count());
+    }
+    return result;
+}
+
+template <typename Index>
+Result runIrving(const std::size_t n, const std::string& generator, const Options& options) {
+
+    std::mt19937_64 rng(options.seed);
+
+    Matrix<Index> pref;
+    pref.set_size(n - 1, n);
+    fillPreferences(pref, n, true, generator, false, generateQuality(n, generator, rng), rng);
+
+    std::vector<std::size_t> matchings(n);
+    matchingR::IrvingScratch<Index> scratch;
+    Result result = {1e300, 0, true};
+    for (std::size_t r = 0; r < options.replications; r++) {
+        const auto start = std::chrono::steady_clock::now();
+        matchingR::roommateRanks(pref, scratch.rank);
+        result.solved = matchingR::irvingMatching(pref, matchings.begin(), scratch);
+        const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+        result.seconds = std::min(result.seconds, elapsed.count());
+    }
+    return result;
+}
+
+template <typename Index>
+Result runTTC(const std::size_t n, const std::string& generator, const Options& options) {
+
+    std::mt19937_64 rng(options.seed);
+
+    Matrix<Index> pref;
+    pref.set_size(n, n);
+    fillPreferences(pref, n, false, generator, false, generateQuality(n, generator, rng), rng);
+
+    std::vector<std::size_t> matchings(n);
+    matchingR::TTCScratch<Index> scratch;
+    Result result = {1e300, 0, true};
+    for (std::size_t r = 0; r < options.replications; r++) {
+        const auto start = std::chrono::steady_clock::now();
+        result.solved = matchingR::ttcMatching(pref, matchings.begin(), scratch);
+        const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+        result.seconds = std::min(result.seconds, elapsed.count());
+    }
+    return result;
+}
+
+template <typename Index>
+Result run(const std::string& algorithm, const std::size_t n, const std::string& generator, const Options& options) {
+    if (algorithm == "galeshapley" || algorithm == "galeshapley-parallel") {
+        return runGaleShapley<Index>(n, generator, algorithm == "galeshapley-parallel", options);
+    }
+    if (algorithm == "irving") {
+        return runIrving<Index>(n, generator, options);
+    }
+    return runTTC<Index>(n, generator, options);
+}
+
+// number of entries of n by n in the tables of each algorithm
+static double tableEntries(const std::string& algorithm, const std::size_t n) {
+    const double n2 = static_cast<double>(n) * n;
+    if (algorithm == "galeshapley" || algorithm == "galeshapley-parallel") {
+        return 3 * n2;
+    }
+    if (algorithm == "irving") {
+        return 4 * n2;
+    }
+    return n2;
+}
+
+static void printRow(const Options& options, const std::string& algorithm, const std::string& generator,
+                     const std::size_t n, const std::size_t threads, const std::size_t indexBytes,
+                     const std::string& status, const Result& result, const double baseline, const long peakRss) {
+    const bool ok = status == "ok" || status == "no_solution";
+    const bool hasProposals = ok && algorithm.compare(0, 11, "galeshapley") == 0;
+    const bool hasSpeedup = ok && algorithm == "galeshapley-parallel" && baseline > 0;
+    char seconds[32] = "", perEntry[32] = "", proposals[32] = "", rate[32] = "", speedup[32] = "", rss[32] = "";
+    if (ok) {
+        snprintf(seconds, sizeof(seconds), "%.6g", result.seconds);
+        snprintf(perEntry, sizeof(perEntry), "%.4g", 1e9 * result.seconds / (static_cast<double>(n) * n));
+        snprintf(rss, sizeof(rss), "%ld", peakRss);
+    }
+    if (hasProposals) {
+        snprintf(proposals, sizeof(proposals), "%.0f", result.proposals);
+        snprintf(rate, sizeof(rate), "%.6g", result.proposals / result.seconds);
+    }
+    if (hasSpeedup) {
+        snprintf(speedup, sizeof(speedup), "%.3g", baseline / result.seconds);
+    }
+    if (options.format == "json") {
+        printf("{\"algorithm\":\"%s\",\"generator\":\"%s\",\"n\":%zu,\"threads\":%zu,\"index_bytes\":%zu,\"status\":\"%s\","
+               "\"seconds\":%s,\"ns_per_entry\":%s,\"proposals\":%s,\"proposals_per_second\":%s,\"speedup\":%s,\"peak_rss\":%s}\n",
+               algorithm.c_str(), generator.c_str(), n, threads, indexBytes, status.c_str(),
+               ok ? seconds : "null", ok ? perEntry : "null", hasProposals ? proposals : "null",
+               hasProposals ? rate : "null", hasSpeedup ? speedup : "null", ok ? rss : "null");
+    } else {
+        printf("%s,%s,%zu,%zu,%zu,%s,%s,%s,%s,%s,%s,%s\n", algorithm.c_str(), generator.c_str(), n, threads, indexBytes,
+               status.c_str(), seconds, perEntry, proposals, rate, speedup, rss);
+    }
+    fflush(stdout);
+}
+
+// Solves one market with the given number of threads in a child process and
+// reports its peak memory use. Returns the running time (0 if the market was
+// not solved). baseline is the running time that the speedup refers to.
+static double benchmark(const Options& options, const std::string& algorithm, const std::string& generator,
+                        const std::size_t n, const std::size_t threads, const double baseline) {
+
+    // the largest index in any table is n + 1 (Irving's linked lists)
+    const std::size_t indexBytes = n + 1 <= UINT16_MAX ? 2 : 4;
+    Result result = {0, 0, false};
+
+    if (tableEntries(algorithm, n) * indexBytes > options.maxMemory) {
+        printRow(options, algorithm, generator, n, threads, indexBytes, "skipped", result, 0, 0);
+        return 0;
+    }
+
+    int fd[2];
+    if (pipe(fd) != 0) {
+        perror("pipe");
+        exit(1);
+    }
+
+    const pid_t pid = fork();
+    if (pid < 0) {
+        perror("fork");
+        exit(1);
+    }
+    if (pid == 0) {
+        close(fd[0]);
+#ifdef _OPENMP
+        omp_set_num_threads(static_cast<int>(threads));
+#endif
+        result = indexBytes == 2 ? run<uint16_t>(algorithm, n, generator, options)
+                                 : run<uint32_t>(algorithm, n, generator, options);
+        const ssize_t written = write(fd[1], &result, sizeof(result));
+        _exit(written == sizeof(result) ? 0 : 1);
+    }
+
+    close(fd[1]);
+    const bool received = read(fd[0], &result, sizeof(result)) == sizeof(result);
+    close(fd[0]);
+
+    int status = 0;
+    struct rusage usage;
+    wait4(pid, &status, 0, &usage);
+
+    std::string outcome = "ok";
+    if (!received || !WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+        outcome = "failed";
+    } else if (!result.solved) {
+        outcome = "no_solution";
+    }
+    printRow(options, algorithm, generator, n, threads, indexBytes, outcome, result, baseline, usage.ru_maxrss);
+    return outcome == "ok" ? result.seconds : 0;
+}
+
+int main(int argc, char** argv) {
+
+    Options options;
+    options.algorithms = splitList("galeshapley,galeshapley-parallel,irving,ttc");
+    options.generators = splitList("uniform,correlated,master,adversarial");
+    options.sizes = {100, 1000, 10000, 100000};
+    options.replications = 3;
+    options.seed = 1;
+    options.maxMemory = 8e9;
+    options.format = "csv";
+    const std::size_t cores = std::max(1u, std::thread::hardware_concurrency());
+    for (std::size_t t = 1; t < cores; t *= 2) {
+        options.threads.push_back(t);
+    }
+    options.threads.push_back(cores);
+
+    for (int i = 1; i + 1 < argc; i += 2) {
+        const std::string key = argv[i], value = argv[i + 1];
+        if (key == "--algorithms") {
+            options.algorithms = splitList(value);
+        } else if (key == "--generators") {
+            options.generators = splitList(value);
+        } else if (key == "--sizes") {
+            options.sizes.clear();
+            for (const std::string& s : splitList(value)) {
+                options.sizes.push_back(static_cast<std::size_t>(std::atof(s.c_str())));
+            }
+        } else if (key == "--threads") {
+            options.threads.clear();
+            for (const std::string& s : splitList(value)) {
+                options.threads.push_back(static_cast<std::size_t>(std::max(1, std::atoi(s.c_str()))));
+            }
+        } else if (key == "--replications") {
+            options.replications = std::max(1, std::atoi(value.c_str()));
+        } else if (key == "--seed") {
+            options.seed = std::strtoul(value.c_str(), NULL, 10);
+        } else if (key == "--max-memory") {
+            options.maxMemory = std::atof(value.c_str());
+        } else if (key == "--format") {
+            options.format = value;
+        } else {
+            fprintf(stderr, "unknown option %s\n", key.c_str());
+            return 1;
+        }
+    }
+    if (argc % 2 == 0) {
+        fprintf(stderr, "option %s needs a value\n", argv[argc - 1]);
+        return 1;
+    }
+
+    for (const std::string& algorithm : options.algorithms) {
+        if (algorithm != "galeshapley" && algorithm != "galeshapley-parallel" && algorithm != "irving" && algorithm != "ttc") {
+            fprintf(stderr, "unknown algorithm %s\n", algorithm.c_str());
+            return 1;
+        }
+    }
+    for (const std::string& generator : options.generators) {
+        if (generator != "uniform" && generator != "correlated" && generator != "master" && generator != "adversarial") {
+            fprintf(stderr, "unknown generator %s\n", generator.c_str());
+            return 1;
+        }
+    }
+
+    if (options.format != "json") {
+        printf("algorithm,generator,n,threads,index_bytes,status,seconds,ns_per_entry,proposals,proposals_per_second,speedup,peak_rss\n");
+    }
+    for (const std::string& algorithm : options.algorithms) {
+        for (const std::string& generator : options.generators) {
+            for (const std::size_t n : options.sizes) {
+                if (algorithm != "galeshapley-parallel") {
+                    benchmark(options, algorithm, generator, n, 1, 0);
+                    continue;
+                }
+                double baseline = 0;
+                for (const std::size_t threads : options.threads) {
+                    const double seconds = benchmark(options, algorithm, generator, n, threads, baseline);
+                    if (baseline == 0) {
+                        baseline = seconds;
+                    }
+                }
+            }
+        }
+    }
+
+    return 0;
+}
@@ -0,0 +1,678 @@
+//  matchingR -- Matching Algorithms in R and C++
+//
+//  Copyright (C) 2015  Jan Tilly <jtilly@econ.upenn.edu>
+//                      Nick Janetos <njanetos@econ.upenn.edu>
+//
+//  This file is part of matchingR.
+//
+//  matchingR is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation, either version 2 of the License, or
+//  (at your option) any later version.
+//
+//  matchingR is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+
+#ifndef matchingR_galeshapley_h
+#define matchingR_galeshapley_h
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <queue>
+#include <vector>
+
+#include "matrix.h"
+#include "statistics.h"
+
+namespace matchingR {
+
+// buffers that can be reused when many markets are solved in a row
+struct GaleShapleyScratch {
+    std::vector<std::size_t> nextProposal, engagedRank;
+    std::queue<std::size_t> bachelors;
+    Statistics statistics;
+};
+
+// buffers of galeShapleyRematch that can be reused across the changes of a
+// market. Between calls, every entry is in its initial state except for those
+// of the agents in touchedProposers and touchedReviewers.
+struct GaleShapleyRematchScratch {
+    std::vector<char> restarted, freed;
+    std::vector<std::size_t> nextProposal, engagedRank;
+    std::vector<std::size_t> touchedProposers, touchedReviewers;
+
+    // resets the entries of the touched agents and sizes the buffers for M
+    // proposers and N reviewers
+    void reset(const std::size_t M, const std::size_t N) {
+        const std::size_t UNKNOWN = static_cast<std::size_t>(-1);
+        for (std::size_t kX = 0; kX < touchedProposers.size(); kX++) {
+            if (touchedProposers[kX] < restarted.size()) {
+                restarted[touchedProposers[kX]] = 0;
+                nextProposal[touchedProposers[kX]] = UNKNOWN;
+            }
+        }
+        for (std::size_t kX = 0; kX < touchedReviewers.size(); kX++) {
+            if (touchedReviewers[kX] < freed.size()) {
+                freed[touchedReviewers[kX]] = 0;
+                engagedRank[touchedReviewers[kX]] = UNKNOWN;
+            }
+        }
+        touchedProposers.clear();
+        touchedReviewers.clear();
+        restarted.resize(M, 0);
+        nextProposal.resize(M, UNKNOWN);
+        freed.resize(N, 0);
+        engagedRank.resize(N, UNKNOWN);
+    }
+};
+
+// Computes the proposer-optimal stable matching. With M proposers and N
+// reviewers, proposerPref is N by M and its column j lists j's preferred
+// reviewers in order, and reviewerUtils is M by N and its element (i, j) is
+// the payoff that reviewer j receives from proposer i. proposals and
+// engagements are random access iterators to M and N elements. Unmatched
+// proposers are matched to N and unmatched reviewers are matched to M. Returns
+// the number of proposals that were made.
+template <typename Pref, typename Utils, typename Iter>
+std::size_t galeShapleyMatching(const Pref& proposerPref, const Utils& reviewerUtils, Iter proposals, Iter engagements, GaleShapleyScratch& scratch) {
+
+    // number of proposers (men)
+    const std::size_t M = proposerPref.n_cols;
+
+    // number of reviewers (women)
+    const std::size_t N = proposerPref.n_rows;
+
+    // create an integer queue of bachelors
+    // the idea of using queues for this problem is borrowed from
+    // http://rosettacode.org/wiki/Stable_marriage_problem#C.2B.2B
+    std::queue<std::size_t>& bachelors = scratch.bachelors;
+    Statistics& statistics = scratch.statistics;
+
+    // set all proposals to N (aka no proposals)
+    for (std::size_t iX = 0; iX < M; iX++) {
+        proposals[iX] = N;
+    }
+
+    // set all engagements to M (aka no engagements)
+    for (std::size_t wX = 0; wX < N; wX++) {
+        engagements[wX] = M;
+    }
+
+    // position in each proposer's preference list of the next proposal: a
+    // proposer never proposes to a reviewer that has already rejected him
+    std::vector<std::size_t>& nextProposal = scratch.nextProposal;
+    nextProposal.assign(M, 0);
+
+    // total number of proposals made
+    std::size_t nProposals = 0;
+
+    // every proposer starts out as a bachelor
+    for (std::size_t iX = M; iX-- > 0; ) {
+        bachelors.push(iX);
+    }
+    statistics.queueLength(bachelors.size());
+
+    // loop until there are no more proposals to be made
+    while (!bachelors.empty()) {
+
+        // get the index of the proposer
+        const std::size_t proposer = bachelors.front();
+
+        // find the best available match for proposer, starting with the most
+        // preferred reviewer that he has not proposed to yet
+        while (nextProposal[proposer] < N) {
+
+            // get the index of the reviewer that the proposer is interested in
+            // and move the proposer's cursor to the next reviewer
+            const std::size_t wX = proposerPref(nextProposal[proposer]++, proposer);
+            nProposals++;
+            statistics.proposal();
+
+            // check if wX is available (`M` means unmatched)
+            if (engagements[wX] == M) {
+
+                // if available, then form a match
+                engagements[wX] = proposer;
+                proposals[proposer] = wX;
+
+                // go to the next proposer
+                break;
+            }
+
+            // wX is already matched, let's see if wX can be poached
+            if (reviewerUtils(proposer, wX) > reviewerUtils(engagements[wX], wX)) {
+
+                // wX's previous partner becomes unmatched (`N` means unmatched)
+                proposals[engagements[wX]] = N;
+                bachelors.push(engagements[wX]);
+                statistics.rejection();
+                statistics.queueLength(bachelors.size());
+
+                // proposer and wX form a match
+                engagements[wX] = proposer;
+                proposals[proposer] = wX;
+
+                // go to the next proposer
+                break;
+            }
+
+            // wX rejects the proposer
+            statistics.rejection();
+        }
+
+        // remove proposer from bachelor queue: proposer will remain unmatched
+        bachelors.pop();
+    }
+
+    return nProposals;
+}
+
+// Computes the proposer-optimal stable matching when the reviewers'
+// preferences are given as ranks: element (i, j) of reviewerRanks is the
+// position of proposer i in reviewer j's preferences (lower is better). A
+// reviewer compares the rank of a new proposer with the rank of the proposer
+// that she is holding on to. Otherwise the same as galeShapleyMatching.
+template <typename Pref, typename Ranks, typename Iter>
+std::size_t galeShapleyMatchingOrdinal(const Pref& proposerPref, const Ranks& reviewerRanks, Iter proposals, Iter engagements, GaleShapleyScratch& scratch) {
+
+    // number of proposers (men)
+    const std::size_t M = proposerPref.n_cols;
+
+    // number of reviewers (women)
+    const std::size_t N = proposerPref.n_rows;
+
+    // set all proposals to N (aka no proposals)
+    for (std::size_t iX = 0; iX < M; iX++) {
+        proposals[iX] = N;
+    }
+
+    // set all engagements to M (aka no engagements)
+    for (std::size_t wX = 0; wX < N; wX++) {
+        engagements[wX] = M;
+    }
+
+    // the rank of each reviewer's current partner (`M` means unmatched, which
+    // is worse than any proposer's rank)
+    std::vector<std::size_t>& engagedRank = scratch.engagedRank;
+    engagedRank.assign(N, M);
+
+    // position in each proposer's preference list of the next proposal
+    std::vector<std::size_t>& nextProposal = scratch.nextProposal;
+    nextProposal.assign(M, 0);
+
+    // total number of proposals made
+    std::size_t nProposals = 0;
+
+    // every proposer starts out as a bachelor
+    std::queue<std::size_t>& bachelors = scratch.bachelors;
+    for (std::size_t iX = M; iX-- > 0; ) {
+        bachelors.push(iX);
+    }
+    Statistics& statistics = scratch.statistics;
+    statistics.queueLength(bachelors.size());
+
+    // loop until there are no more proposals to be made
+    while (!bachelors.empty()) {
+
+        // get the index of the proposer
+        const std::size_t proposer = bachelors.front();
+        bachelors.pop();
+
+        while (nextProposal[proposer] < N) {
+
+            const std::size_t wX = proposerPref(nextProposal[proposer]++, proposer);
+            nProposals++;
+            statistics.proposal();
+
+            // rank of the proposer in wX's preferences (lower is better)
+            const std::size_t rank = reviewerRanks(proposer, wX);
+
+            // wX prefers the proposer over her current partner (if any)
+            if (rank < engagedRank[wX]) {
+
+                // wX's previous partner becomes unmatched (`N` means unmatched)
+                if (engagements[wX] != M) {
+                    proposals[engagements[wX]] = N;
+                    bachelors.push(engagements[wX]);
+                    statistics.rejection();
+                    statistics.queueLength(bachelors.size());
+                }
+
+                // proposer and wX form a match
+                engagements[wX] = proposer;
+                engagedRank[wX] = rank;
+                proposals[proposer] = wX;
+
+                // go to the next proposer
+                break;
+            }
+
+            // wX rejects the proposer
+            statistics.rejection();
+        }
+    }
+
+    return nProposals;
+}
+
+// Computes the same matching as galeShapleyMatchingOrdinal with several
+// threads. Deferred acceptance yields the proposer-optimal stable matching
+// whatever the order of the proposals, so the proposers are split into blocks
+// that the threads take from a shared pool (OpenMP's dynamic schedule). Each
+// thread keeps the bachelors of its blocks in its own queue, including those
+// that it makes single by poaching their partners. The rank and the index of
+// the proposer that each reviewer holds on to are packed into one 64-bit
+// word, which is updated with compare-and-swap. Reviewers' ranks must be
+// strict. Falls back to the sequential algorithm if a market has 2^32 or more
+// proposers. Compile with OpenMP to use more than one thread.
+template <typename Pref, typename Ranks, typename Iter>
+std::size_t galeShapleyMatchingParallel(const Pref& proposerPref, const Ranks& reviewerRanks, Iter proposals, Iter engagements, GaleShapleyScratch& scratch) {
+
+    // number of proposers (men)
+    const std::size_t M = proposerPref.n_cols;
+
+    // number of reviewers (women)
+    const std::size_t N = proposerPref.n_rows;
+
+    if (static_cast<uint64_t>(M) > UINT32_MAX) {
+        return galeShapleyMatchingOrdinal(proposerPref, reviewerRanks, proposals, engagements, scratch);
+    }
+
+    // the proposer that each reviewer holds on to in the lower 32 bits and
+    // his rank in the upper 32 bits; an unmatched reviewer holds on to M with
+    // rank M, which is worse than any proposer's rank
+    const uint64_t lower = UINT32_MAX;
+    std::vector< std::atomic<uint64_t> > held(N);
+    for (std::size_t wX = 0; wX < N; wX++) {
+        held[wX].store((static_cast<uint64_t>(M) << 32) | M, std::memory_order_relaxed);
+    }
+
+    // position in each proposer's preference list of the next proposal. Only
+    // the thread whose queue holds a proposer reads or writes his position;
+    // the compare-and-swap that hands him over to another thread orders the
+    // accesses.
+    std::vector<std::size_t>& nextProposal = scratch.nextProposal;
+    nextProposal.assign(M, 0);
+
+    // total number of proposals made
+    std::size_t nProposals = 0;
+
+    // blocks of proposers that the threads take from the pool; a thread works
+    // through the proposals of a whole block, so that it can interleave
+    // independent proposals as the sequential algorithm does
+    const std::size_t blockSize = 256;
+    const std::size_t nBlocks = (M + blockSize - 1) / blockSize;
+
+    #pragma omp parallel reduction(+:nProposals)
+    {
+        // bachelors and statistics of this thread
+        std::queue<std::size_t> bachelors;
+        Statistics statistics;
+
+        #pragma omp for schedule(dynamic)
+        for (std::size_t bX = 0; bX < nBlocks; bX++) {
+
+            for (std::size_t iX = bX * blockSize; iX < M && iX < (bX + 1) * blockSize; iX++) {
+                bachelors.push(iX);
+            }
+            statistics.queueLength(bachelors.size());
+
+            while (!bachelors.empty()) {
+
+                // get the index of the proposer
+                const std::size_t proposer = bachelors.front();
+                bachelors.pop();
+
+                while (nextProposal[proposer] < N) {
+
+                    const std::size_t wX = proposerPref(nextProposal[proposer]++, proposer);
+                    nProposals++;
+                    statistics.proposal();
+
+                    // rank of the proposer in wX's preferences (lower is better)
+                    const uint64_t rank = reviewerRanks(proposer, wX);
+                    const uint64_t offer = (rank << 32) | proposer;
+
+                    // replace wX's current partner if she prefers the proposer;
+                    // retry if another thread changed her partner in the meantime
+                    uint64_t current = held[wX].load(std::memory_order_acquire);
+                    while (rank < (current >> 32) &&
+                           !held[wX].compare_exchange_weak(current, offer, std::memory_order_acq_rel, std::memory_order_acquire)) {
+                        statistics.retry();
+                    }
+
+                    if (rank < (current >> 32)) {
+
+                        // wX's previous partner (if any) becomes a bachelor of
+                        // this thread
+                        if ((current & lower) != M) {
+                            bachelors.push(static_cast<std::size_t>(current & lower));
+                            statistics.rejection();
+                            statistics.queueLength(bachelors.size());
+                        }
+
+                        // go to the next proposer
+                        break;
+                    }
+
+                    // wX rejects the proposer
+                    statistics.rejection();
+                }
+            }
+        }
+
+        if (Statistics::enabled) {
+            #pragma omp critical
+            scratch.statistics.merge(statistics);
+        }
+    }
+
+    // set all proposals to N (aka no proposals)
+    for (std::size_t iX = 0; iX < M; iX++) {
+        proposals[iX] = N;
+    }
+
+    // read off the engagements (`M` means unmatched)
+    for (std::size_t wX = 0; wX < N; wX++) {
+        const std::size_t proposer = static_cast<std::size_t>(held[wX].load(std::memory_order_relaxed) & lower);
+        engagements[wX] = proposer;
+        if (proposer != M) {
+            proposals[proposer] = wX;
+        }
+    }
+
+    return nProposals;
+}
+
+// Computes the proposer-optimal and the reviewer-optimal stable matching of
+// the same market, each on its own thread if compiled with OpenMP. The
+// proposers' side is as in galeShapleyMatchingOrdinal; reviewerPref is M by N
+// and proposerRanks is N by M and hold the reviewers' preference orders and
+// the proposers' ranks. Both runs only read the shared tables. The
+// reviewer-optimal matching is written to reviewerProposals and
+// reviewerEngagements, which follow the same conventions as proposals and
+// engagements. By the rural hospitals theorem, the agents that are matched
+// to the same partner in both matchings are matched to that partner in every
+// stable matching. Returns the total number of proposals of both runs.
+template <typename Pref, typename Ranks, typename Iter>
+std::size_t galeShapleyExtremalMatchings(const Pref& proposerPref, const Ranks& proposerRanks,
+                                         const Pref& reviewerPref, const Ranks& reviewerRanks,
+                                         Iter proposals, Iter engagements,
+                                         Iter reviewerProposals, Iter reviewerEngagements) {
+
+    std::size_t nProposals = 0, nReviewerProposals = 0;
+
+    #pragma omp parallel sections num_threads(2)
+    {
+        #pragma omp section
+        {
+            GaleShapleyScratch scratch;
+            nProposals = galeShapleyMatchingOrdinal(proposerPref, reviewerRanks, proposals, engagements, scratch);
+        }
+
+        #pragma omp section
+        {
+            // reviewers propose: their proposals are engagements of the
+            // proposers and vice versa
+            GaleShapleyScratch scratch;
+            nReviewerProposals = galeShapleyMatchingOrdinal(reviewerPref, proposerRanks, reviewerEngagements, reviewerProposals, scratch);
+        }
+    }
+
+    return nProposals + nReviewerProposals;
+}
+
+// Repairs a stable matching of a market with truncated preference lists after
+// some agents changed their lists, joined, or left. The preference lists of
+// the new market are given in compressed sparse row format: the list of
+// proposer i is stored in elements proposerPtr(i) to proposerPtr(i + 1) - 1 of
+// proposerIdx, and likewise for the reviewers. On entry, proposals and
+// engagements hold the previous stable matching in terms of the agents of the
+// new market (N and M mean unmatched, as in galeShapleyMatching).
+// changedProposers and changedReviewers list the agents whose preference lists
+// changed, that are new, or whose partner left the market.
+//
+// Deferred acceptance is restarted only from the proposers whose partner may
+// no longer be stable: starting from the changed agents, a proposer is
+// restarted from the top of his list if a reviewer whose partner changes lists
+// him and he prefers her to his partner, and the partner of a restarted
+// proposer is freed in turn. All other proposers keep their partners and, if
+// they are rejected later on, continue with the next reviewer in their list.
+// Ranks are found by scanning the short lists of the agents involved, so that
+// only the lists of these agents are read. The result is a stable matching of
+// the new market. It is the proposer-optimal one if the previous matching was
+// proposer-optimal and the market only gained proposers or lost reviewers;
+// otherwise some proposers may be matched to a less preferred stable partner.
+//
+// The buffers in scratch are indexed by agent. Only the entries of the agents
+// involved are reset, at the start of the next call, so that if scratch is
+// reused across the changes of a market, the running time of a call is
+// proportional to the lengths of the lists that are read (plus the number of
+// agents that joined) rather than the size of the market.
+//
+// Returns false if a list refers to an agent that does not exist. Otherwise
+// returns true and sets nProposals to the number of proposals that were made.
+template <typename ProposerPtr, typename ProposerIdx, typename ReviewerPtr, typename ReviewerIdx, typename Changed, typename Iter>
+bool galeShapleyRematch(const ProposerPtr& proposerPtr, const ProposerIdx& proposerIdx,
+                        const ReviewerPtr& reviewerPtr, const ReviewerIdx& reviewerIdx,
+                        const Changed& changedProposers, const Changed& changedReviewers,
+                        Iter proposals, Iter engagements, std::size_t& nProposals,
+                        GaleShapleyRematchScratch& scratch) {
+
+    // number of proposers (men)
+    const std::size_t M = proposerPtr.n_elem - 1;
+
+    // number of reviewers (women)
+    const std::size_t N = reviewerPtr.n_elem - 1;
+
+    // marks a rank or a position in a list that has not been looked up yet
+    const std::size_t UNKNOWN = static_cast<std::size_t>(-1);
+
+    // undo the previous call for the agents that it touched
+    scratch.reset(M, N);
+
+    // proposers that restart from the top of their lists and reviewers whose
+    // partner may change
+    std::vector<char>& restarted = scratch.restarted;
+    std::vector<char>& freed = scratch.freed;
+
+    // reviewers whose lists still need to be searched for proposers that
+    // prefer them to their partners
+    std::queue<std::size_t> pending;
+
+    // bachelors that make proposals once the matching has been repaired
+    std::queue<std::size_t> bachelors;
+
+    // position in each proposer's list of the next proposal; proposers that
+    // keep their partners continue after their partner if they are rejected
+    std::vector<std::size_t>& nextProposal = scratch.nextProposal;
+
+    // the rank of each reviewer's partner (looked up when it is needed)
+    std::vector<std::size_t>& engagedRank = scratch.engagedRank;
+
+    // agents whose entries have to be reset by the next call
+    std::vector<std::size_t>& touchedProposers = scratch.touchedProposers;
+    std::vector<std::size_t>& touchedReviewers = scratch.touchedReviewers;
+
+    // position of wX in the list of proposer iX (UNKNOWN if he does not list her)
+    auto proposerRank = [&](const std::size_t iX, const std::size_t wX) -> std::size_t {
+        for (std::size_t kX = proposerPtr(iX); kX < proposerPtr(iX + 1); kX++) {
+            if (proposerIdx(kX) == wX) {
+                return kX - proposerPtr(iX);
+            }
+        }
+        return UNKNOWN;
+    };
+
+    // position of iX in the list of reviewer wX (UNKNOWN if she does not list him)
+    auto reviewerRank = [&](const std::size_t wX, const std::size_t iX) -> std::size_t {
+        for (std::size_t kX = reviewerPtr(wX); kX < reviewerPtr(wX + 1); kX++) {
+            if (reviewerIdx(kX) == iX) {
+                return kX - reviewerPtr(wX);
+            }
+        }
+        return UNKNOWN;
+    };
+
+    // the partner of wX may change, so her list has to be searched
+    auto release = [&](const std::size_t wX) {
+        if (!freed[wX]) {
+            freed[wX] = 1;
+            touchedReviewers.push_back(wX);
+            pending.push(wX);
+        }
+    };
+
+    // the proposer gives up his partner and starts over
+    auto restart = [&](const std::size_t iX) {
+        if (restarted[iX]) {
+            return;
+        }
+        restarted[iX] = 1;
+        touchedProposers.push_back(iX);
+        nextProposal[iX] = 0;
+        if (proposals[iX] != N) {
+            engagements[proposals[iX]] = M;
+            release(proposals[iX]);
+            proposals[iX] = N;
+        }
+        bachelors.push(iX);
+    };
+
+    for (std::size_t kX = 0; kX < changedProposers.n_elem; kX++) {
+        if (changedProposers(kX) >= M) {
+            return false;
+        }
+        restart(changedProposers(kX));
+    }
+
+    for (std::size_t kX = 0; kX < changedReviewers.n_elem; kX++) {
+        if (changedReviewers(kX) >= N) {
+            return false;
+        }
+        release(changedReviewers(kX));
+    }
+
+    while (!pending.empty()) {
+
+        const std::size_t wX = pending.front();
+        pending.pop();
+
+        // does wX still find her partner acceptable?
+        bool listed = false;
+
+        for (std::size_t kX = reviewerPtr(wX); kX < reviewerPtr(wX + 1); kX++) {
+
+            const std::size_t iX = reviewerIdx(kX);
+            if (iX >= M) {
+                return false;
+            }
+            if (iX == engagements[wX]) {
+                listed = true;
+                continue;
+            }
+            if (restarted[iX]) {
+                continue;
+            }
+
+            // restart iX if he lists wX before his partner (or is unmatched)
+            for (std::size_t lX = proposerPtr(iX); lX < proposerPtr(iX + 1); lX++) {
+                const std::size_t jX = proposerIdx(lX);
+                if (jX >= N) {
+                    return false;
+                }
+                if (jX == proposals[iX]) {
+                    break;
+                }
+                if (jX == wX) {
+                    restart(iX);
+                    break;
+                }
+            }
+        }
+
+        if (engagements[wX] != M && !listed) {
+            restart(engagements[wX]);
+        }
+    }
+
+    // deferred acceptance from the repaired matching
+    nProposals = 0;
+
+    while (!bachelors.empty()) {
+
+        // get the index of the proposer
+        const std::size_t proposer = bachelors.front();
+        bachelors.pop();
+
+        while (proposerPtr(proposer) + nextProposal[proposer] < proposerPtr(proposer + 1)) {
+
+            const std::size_t wX = proposerIdx(proposerPtr(proposer) + nextProposal[proposer]++);
+            if (wX >= N) {
+                return false;
+            }
+
+            // rank of the proposer in wX's preferences (lower is better)
+            const std::size_t rank = reviewerRank(wX, proposer);
+
+            // wX does not find the proposer acceptable
+            if (rank == UNKNOWN) {
+                continue;
+            }
+
+            nProposals++;
+
+            if (engagements[wX] != M && engagedRank[wX] == UNKNOWN) {
+                engagedRank[wX] = reviewerRank(wX, engagements[wX]);
+                touchedReviewers.push_back(wX);
+            }
+
+            // wX is single or prefers the proposer over her current partner
+            if (engagements[wX] == M || rank < engagedRank[wX]) {
+
+                // wX's previous partner becomes a bachelor and continues with
+                // the next reviewer in his list
+                if (engagements[wX] != M) {
+                    const std::size_t rejected = engagements[wX];
+                    if (nextProposal[rejected] == UNKNOWN) {
+                        nextProposal[rejected] = proposerRank(rejected, wX) + 1;
+                        touchedProposers.push_back(rejected);
+                    }
+                    proposals[rejected] = N;
+                    bachelors.push(rejected);
+                }
+
+                // proposer and wX form a match
+                if (engagedRank[wX] == UNKNOWN) {
+                    touchedReviewers.push_back(wX);
+                }
+                engagements[wX] = proposer;
+                engagedRank[wX] = rank;
+                proposals[proposer] = wX;
+
+                // go to the next proposer
+                break;
+            }
+        }
+    }
+
+    return true;
+}
+
+// Same as above with buffers that are only used for one call.
+template <typename ProposerPtr, typename ProposerIdx, typename ReviewerPtr, typename ReviewerIdx, typename Changed, typename Iter>
+bool galeShapleyRematch(const ProposerPtr& proposerPtr, const ProposerIdx& proposerIdx,
+                        const ReviewerPtr& reviewerPtr, const ReviewerIdx& reviewerIdx,
+                        const Changed& changedProposers, const Changed& changedReviewers,
+                        Iter proposals, Iter engagements, std::size_t& nProposals) {
+    GaleShapleyRematchScratch scratch;
+    return galeShapleyRematch(proposerPtr, proposerIdx, reviewerPtr, reviewerIdx, changedProposers, changedReviewers,
+                              proposals, engagements, nProposals, scratch);
+}
+
+}
+
+#endif
@@ -0,0 +1,582 @@
+//  matchingR -- Matching Algorithms in R and C++
+//
+//  Copyright (C) 2015  Jan Tilly <jtilly@econ.upenn.edu>
+//                      Nick Janetos <njanetos@econ.upenn.edu>
+//
+//  This file is part of matchingR.
+//
+//  matchingR is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation, either version 2 of the License, or
+//  (at your option) any later version.
+//
+//  matchingR is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+
+#ifndef matchingR_lattice_h
+#define matchingR_lattice_h
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <queue>
+#include <utility>
+#include <vector>
+
+#include "galeshapley.h"
+#include "matrix.h"
+
+namespace matchingR {
+
+// The rotations of a marriage market and the precedence relation between
+// them. Rotations are numbered in the order in which they can be eliminated,
+// starting from the proposer-optimal matching, so that every rotation comes
+// after its predecessors.
+struct RotationPoset {
+
+    // the pairs of rotation r are the elements ptr[r] to ptr[r + 1] - 1 of
+    // proposers and reviewers. Each proposer is matched to his reviewer before
+    // r is eliminated and to the reviewer of the next pair (the first pair
+    // for the last one) afterwards.
+    std::vector<std::size_t> ptr, proposers, reviewers;
+
+    // the rotations that must be eliminated before r are elements predPtr[r]
+    // to predPtr[r + 1] - 1 of pred. These generate the precedence relation,
+    // which is their transitive closure.
+    std::vector<std::size_t> predPtr, pred;
+
+    std::size_t size() const { return ptr.empty() ? 0 : ptr.size() - 1; }
+};
+
+// Finds all rotations and the precedence relation between them in time
+// proportional to the size of the preference tables (Gusfield 1987). With M
+// proposers and N reviewers, proposerPref and proposerRanks are N by M, and
+// element (i, j) is j's ith favorite reviewer and the position of reviewer i
+// in j's preferences, respectively. reviewerPref and reviewerRanks are M by N
+// and hold the same for the reviewers. On entry, proposals and engagements
+// hold the proposer-optimal matching (N and M mean unmatched, as in
+// galeShapleyMatching). On exit, they hold the reviewer-optimal matching.
+//
+// Starting from a proposer who is not matched to his reviewer-optimal
+// partner, the algorithm follows each proposer to the partner of the first
+// reviewer after his own partner who prefers him to her partner, until it
+// returns to a proposer on its path, which closes a rotation. The rotation is
+// eliminated right away, and the search continues with the rest of the path.
+// Proposers only move down their lists, so every list is read once.
+template <typename Pref, typename Ranks, typename Iter>
+void rotationPoset(const Pref& proposerPref, const Ranks& proposerRanks,
+                   const Pref& reviewerPref, const Ranks& reviewerRanks,
+                   Iter proposals, Iter engagements, RotationPoset& poset) {
+
+    // number of proposers (men)
+    const std::size_t M = proposerPref.n_cols;
+
+    // number of reviewers (women)
+    const std::size_t N = proposerPref.n_rows;
+
+    const std::size_t NONE = static_cast<std::size_t>(-1);
+
+    poset.ptr.assign(1, 0);
+    poset.predPtr.assign(1, 0);
+    poset.proposers.clear();
+    poset.reviewers.clear();
+    poset.pred.clear();
+
+    // position in each proposer's list from which his next acceptable reviewer
+    // is searched; it only moves forward because proposers only move down
+    // their lists and reviewers only up theirs
+    std::vector<std::size_t> cursor(M, N);
+    for (std::size_t iX = 0; iX < M; iX++) {
+        if (proposals[iX] != N) {
+            cursor[iX] = proposerRanks(proposals[iX], iX) + 1;
+        }
+    }
+
+    // the first reviewer after the proposer's partner who prefers him to her
+    // partner (N if there is none). Reviewers that are unmatched in one stable
+    // matching are unmatched in all of them and can be ignored.
+    auto successor = [&](const std::size_t iX) -> std::size_t {
+        for (; cursor[iX] < N; cursor[iX]++) {
+            const std::size_t wX = proposerPref(cursor[iX], iX);
+            if (engagements[wX] != M && reviewerRanks(iX, wX) < reviewerRanks(engagements[wX], wX)) {
+                return wX;
+            }
+        }
+        return N;
+    };
+
+    // element (i, j) is the rotation that moved reviewer i from a partner
+    // that she likes less than proposer j to one that she likes more. Every
+    // pair is in at most one rotation, and every rotation has at least two
+    // pairs, so the labels fit into 32 bits for any market whose tables fit
+    // into memory.
+    const std::uint32_t UNLABELED = UINT32_MAX;
+    Matrix<std::uint32_t> passed;
+    passed.set_size(N, M);
+    passed.fill(UNLABELED);
+
+    // the last rotation that moved each proposer
+    std::vector<std::size_t> lastRotation(M, NONE);
+
+    // the rotation for which a predecessor was last recorded, to avoid
+    // recording it twice
+    std::vector<std::size_t> recorded;
+    auto addPredecessor = [&](const std::size_t rX, const std::size_t pX) {
+        if (recorded[pX] != rX) {
+            recorded[pX] = rX;
+            poset.pred.push_back(pX);
+        }
+    };
+
+    // the current path of proposers and the position of each proposer on it
+    std::vector<std::size_t> path;
+    std::vector<std::size_t> onPath(M, NONE);
+
+    // a path can only start at a proposer who is not yet matched to his
+    // reviewer-optimal partner; it then only visits such proposers
+    std::vector<std::size_t> reviewerOptimal(M), reviewerEngagements(N);
+    GaleShapleyScratch scratch;
+    galeShapleyMatchingOrdinal(reviewerPref, proposerRanks, reviewerEngagements.begin(), reviewerOptimal.begin(), scratch);
+
+    // proposers before start have reached their reviewer-optimal partners
+    std::size_t start = 0;
+
+    for (;;) {
+
+        if (path.empty()) {
+            while (start < M && proposals[start] == reviewerOptimal[start]) {
+                start++;
+            }
+            if (start == M) {
+                break;
+            }
+            onPath[start] = 0;
+            path.push_back(start);
+        }
+
+        const std::size_t iX = path.back();
+        const std::size_t wX = successor(iX);
+
+        // only happens if the input is not the proposer-optimal matching
+        if (wX == N) {
+            return;
+        }
+
+        const std::size_t next = engagements[wX];
+        if (onPath[next] == NONE) {
+            onPath[next] = path.size();
+            path.push_back(next);
+            continue;
+        }
+
+        // the path from next to iX is a rotation
+        const std::size_t rX = poset.size();
+        const std::size_t first = onPath[next];
+        recorded.push_back(NONE);
+
+        for (std::size_t kX = first; kX < path.size(); kX++) {
+            poset.proposers.push_back(path[kX]);
+            poset.reviewers.push_back(proposals[path[kX]]);
+        }
+        poset.ptr.push_back(poset.proposers.size());
+
+        // a rotation comes after the last rotation that moved one of its
+        // proposers, and after the rotations that moved a reviewer whom one
+        // of its proposers skips past the proposer
+        for (std::size_t kX = first; kX < path.size(); kX++) {
+            const std::size_t mX = path[kX];
+            if (lastRotation[mX] != NONE) {
+                addPredecessor(rX, lastRotation[mX]);
+            }
+            lastRotation[mX] = rX;
+            for (std::size_t pos = proposerRanks(proposals[mX], mX) + 1; pos < cursor[mX]; pos++) {
+                const std::uint32_t label = passed(proposerPref(pos, mX), mX);
+                if (label != UNLABELED) {
+                    addPredecessor(rX, label);
+                }
+            }
+        }
+        poset.predPtr.push_back(poset.pred.size());
+
+        // each reviewer of the rotation now passes the proposers between her
+        // new and her old partner
+        for (std::size_t kX = first; kX < path.size(); kX++) {
+            const std::size_t mX = path[kX];
+            const std::size_t wNew = proposerPref(cursor[mX], mX);
+            const std::size_t mOld = engagements[wNew];
+            for (std::size_t pos = reviewerRanks(mX, wNew) + 1; pos < reviewerRanks(mOld, wNew); pos++) {
+                passed(wNew, reviewerPref(pos, wNew)) = static_cast<std::uint32_t>(rX);
+            }
+        }
+
+        // eliminate the rotation
+        for (std::size_t kX = first; kX < path.size(); kX++) {
+            const std::size_t mX = path[kX];
+            const std::size_t wNew = proposerPref(cursor[mX]++, mX);
+            proposals[mX] = wNew;
+            engagements[wNew] = mX;
+            onPath[mX] = NONE;
+        }
+        path.resize(first);
+    }
+}
+
+// Eliminates the rotations r for which eliminate[r] is true from the matching
+// in proposals and engagements. The rotations must be closed under
+// predecessors, and the matching must be the one in which they are exposed,
+// e.g. the proposer-optimal matching.
+template <typename Iter>
+void eliminateRotations(const RotationPoset& poset, const std::vector<char>& eliminate, Iter proposals, Iter engagements) {
+    for (std::size_t rX = 0; rX < poset.size(); rX++) {
+        if (!eliminate[rX]) {
+            continue;
+        }
+        for (std::size_t kX = poset.ptr[rX]; kX < poset.ptr[rX + 1]; kX++) {
+            const std::size_t wNew = poset.reviewers[kX + 1 < poset.ptr[rX + 1] ? kX + 1 : poset.ptr[rX]];
+            proposals[poset.proposers[kX]] = wNew;
+            engagements[wNew] = poset.proposers[kX];
+        }
+    }
+}
+
+// Minimum cut of a flow network (Dinic's algorithm), used to find closed sets
+// of rotations with the smallest weight.
+class MinCut {
+public:
+    explicit MinCut(const std::size_t n) : NONE(static_cast<std::size_t>(-1)), head(n, NONE), level(n), current(n) {}
+
+    void addEdge(const std::size_t from, const std::size_t to, const std::int64_t capacity) {
+        target.push_back(to);
+        residual.push_back(capacity);
+        next.push_back(head[from]);
+        head[from] = target.size() - 1;
+        target.push_back(from);
+        residual.push_back(0);
+        next.push_back(head[to]);
+        head[to] = target.size() - 1;
+    }
+
+    // sends the maximum flow from source to sink and returns its value.
+    // Afterwards, sourceSide(v) is true if v is on the source's side of a
+    // minimum cut.
+    std::int64_t maxFlow(const std::size_t source, const std::size_t sink) {
+        std::int64_t flow = 0;
+        while (levels(source, sink)) {
+            current = head;
+            for (std::int64_t f; (f = augment(source, sink)) > 0; ) {
+                flow += f;
+            }
+        }
+        return flow;
+    }
+
+    bool sourceSide(const std::size_t v) const { return level[v] != NONE; }
+
+private:
+    const std::size_t NONE;
+
+    // edges are stored in pairs, so that edge e ^ 1 is the reverse of e
+    std::vector<std::size_t> head, target, next;
+    std::vector<std::int64_t> residual;
+    std::vector<std::size_t> level, current, path;
+
+    // breadth-first search from the source in the residual network
+    bool levels(const std::size_t source, const std::size_t sink) {
+        level.assign(level.size(), NONE);
+        level[source] = 0;
+        std::queue<std::size_t> queue;
+        queue.push(source);
+        while (!queue.empty()) {
+            const std::size_t v = queue.front();
+            queue.pop();
+            for (std::size_t e = head[v]; e != NONE; e = next[e]) {
+                if (residual[e] > 0 && level[target[e]] == NONE) {
+                    level[target[e]] = level[v] + 1;
+                    queue.push(target[e]);
+                }
+            }
+        }
+        return level[sink] != NONE;
+    }
+
+    // finds one path from the source to the sink in the level graph and
+    // saturates it; nodes that lead nowhere are removed from the level graph
+    std::int64_t augment(const std::size_t source, const std::size_t sink) {
+        path.clear();
+        std::size_t v = source;
+        while (v != sink) {
+            std::size_t& e = current[v];
+            while (e != NONE && (residual[e] == 0 || level[target[e]] != level[v] + 1)) {
+                e = next[e];
+            }
+            if (e == NONE) {
+                if (path.empty()) {
+                    return 0;
+                }
+                level[v] = NONE;
+                v = target[path.back() ^ 1];
+                path.pop_back();
+            } else {
+                path.push_back(e);
+                v = target[e];
+            }
+        }
+        std::int64_t f = residual[path[0]];
+        for (std::size_t kX = 1; kX < path.size(); kX++) {
+            f = std::min(f, residual[path[kX]]);
+        }
+        for (std::size_t kX = 0; kX < path.size(); kX++) {
+            residual[path[kX]] -= f;
+            residual[path[kX] ^ 1] += f;
+        }
+        return f;
+    }
+};
+
+// Chooses the rotations whose elimination from the proposer-optimal matching
+// yields an egalitarian stable matching, i.e. one that minimizes the sum of
+// the positions of all agents' partners in their preferences. Each rotation
+// changes this sum by a fixed amount, and a set of rotations can be
+// eliminated if it is closed under predecessors, so the best set is a minimum
+// weight closure of the poset, which is found with a minimum cut (Picard
+// 1976). The tables are the same as for rotationPoset.
+template <typename Ranks>
+void egalitarianRotations(const RotationPoset& poset, const Ranks& proposerRanks, const Ranks& reviewerRanks, std::vector<char>& eliminate) {
+
+    const std::size_t R = poset.size();
+    const std::size_t source = R, sink = R + 1;
+    MinCut cut(R + 2);
+
+    // eliminating a rotation is worth the decrease in the sum of positions;
+    // rotations that increase the sum cost as much as they increase it
+    std::int64_t total = 0;
+    for (std::size_t rX = 0; rX < R; rX++) {
+        std::int64_t change = 0;
+        for (std::size_t kX = poset.ptr[rX]; kX < poset.ptr[rX + 1]; kX++) {
+            const std::size_t kNext = kX + 1 < poset.ptr[rX + 1] ? kX + 1 : poset.ptr[rX];
+            const std::size_t mX = poset.proposers[kX], wOld = poset.reviewers[kX];
+            const std::size_t wNew = poset.reviewers[kNext], mOld = poset.proposers[kNext];
+            change += static_cast<std::int64_t>(proposerRanks(wNew, mX)) - static_cast<std::int64_t>(proposerRanks(wOld, mX));
+            change += static_cast<std::int64_t>(reviewerRanks(mX, wNew)) - static_cast<std::int64_t>(reviewerRanks(mOld, wNew));
+        }
+        if (change < 0) {
+            cut.addEdge(source, rX, -change);
+            total -= change;
+        } else if (change > 0) {
+            cut.addEdge(rX, sink, change);
+        }
+    }
+
+    // a rotation cannot be eliminated without its predecessors
+    for (std::size_t rX = 0; rX < R; rX++) {
+        for (std::size_t kX = poset.predPtr[rX]; kX < poset.predPtr[rX + 1]; kX++) {
+            cut.addEdge(rX, poset.pred[kX], total + 1);
+        }
+    }
+
+    cut.maxFlow(source, sink);
+
+    eliminate.assign(R, 0);
+    for (std::size_t rX = 0; rX < R; rX++) {
+        eliminate[rX] = cut.sourceSide(rX);
+    }
+}
+
+// Chooses the rotations whose elimination from the proposer-optimal matching
+// yields a minimum regret stable matching, i.e. one in which the agent that
+// is worst off is matched to a partner in the highest possible position of
+// its preferences. proposals and engagements hold the proposer-optimal
+// matching. Whether the regret can be at most k is decided by the smallest
+// closed set of rotations that moves every reviewer to a partner in one of
+// her first k + 1 positions: it is feasible if no rotation in the set moves a
+// proposer beyond his first k + 1 positions. The smallest feasible k is found
+// by bisection. The tables are the same as for rotationPoset.
+template <typename Ranks, typename Iter>
+void minimumRegretRotations(const RotationPoset& poset, const Ranks& proposerRanks, const Ranks& reviewerRanks,
+                            Iter proposals, Iter engagements, std::vector<char>& eliminate) {
+
+    // number of proposers (men)
+    const std::size_t M = reviewerRanks.n_rows;
+
+    // number of reviewers (women)
+    const std::size_t N = reviewerRanks.n_cols;
+
+    const std::size_t R = poset.size();
+
+    // the worst position of a proposer's partner in each rotation, and the
+    // rotations that move each reviewer in the order in which they move her
+    // (together with the proposers that they move her to)
+    std::vector<std::size_t> proposerRegret(R, 0);
+    std::vector< std::vector< std::pair<std::size_t, std::size_t> > > moves(N);
+    for (std::size_t rX = 0; rX < R; rX++) {
+        for (std::size_t kX = poset.ptr[rX]; kX < poset.ptr[rX + 1]; kX++) {
+            const std::size_t wNew = poset.reviewers[kX + 1 < poset.ptr[rX + 1] ? kX + 1 : poset.ptr[rX]];
+            proposerRegret[rX] = std::max<std::size_t>(proposerRegret[rX], proposerRanks(wNew, poset.proposers[kX]));
+            moves[wNew].push_back(std::make_pair(rX, poset.proposers[kX]));
+        }
+    }
+
+    // proposers are best off and reviewers worst off in the proposer-optimal
+    // matching
+    std::size_t lower = 0, upper = 0;
+    for (std::size_t iX = 0; iX < M; iX++) {
+        if (proposals[iX] != N) {
+            lower = std::max<std::size_t>(lower, proposerRanks(proposals[iX], iX));
+            upper = std::max<std::size_t>(upper, reviewerRanks(iX, proposals[iX]));
+        }
+    }
+    upper = std::max(lower, upper);
+
+    std::vector<char> closure(R);
+    std::vector<std::size_t> stack;
+
+    // the smallest closed set of rotations after which every reviewer is
+    // matched to one of her first k + 1 partners; false if that set moves a
+    // proposer beyond his first k + 1 partners or if there is no such set
+    auto feasible = [&](const std::size_t k) -> bool {
+        closure.assign(R, 0);
+        stack.clear();
+        for (std::size_t wX = 0; wX < N; wX++) {
+            if (engagements[wX] == M || reviewerRanks(engagements[wX], wX) <= k) {
+                continue;
+            }
+            // the first rotation that gives wX a partner that is good enough
+            std::size_t rX = R;
+            for (std::size_t lX = 0; lX < moves[wX].size(); lX++) {
+                if (reviewerRanks(moves[wX][lX].second, wX) <= k) {
+                    rX = moves[wX][lX].first;
+                    break;
+                }
+            }
+            if (rX == R) {
+                return false;
+            }
+            if (!closure[rX]) {
+                closure[rX] = 1;
+                stack.push_back(rX);
+            }
+        }
+        while (!stack.empty()) {
+            const std::size_t rX = stack.back();
+            stack.pop_back();
+            if (proposerRegret[rX] > k) {
+                return false;
+            }
+            for (std::size_t kX = poset.predPtr[rX]; kX < poset.predPtr[rX + 1]; kX++) {
+                if (!closure[poset.pred[kX]]) {
+                    closure[poset.pred[kX]] = 1;
+                    stack.push_back(poset.pred[kX]);
+                }
+            }
+        }
+        return true;
+    };
+
+    // the proposer-optimal matching has regret upper
+    while (lower < upper) {
+        const std::size_t k = lower + (upper - lower) / 2;
+        if (feasible(k)) {
+            upper = k;
+        } else {
+            lower = k + 1;
+        }
+    }
+
+    feasible(upper);
+    eliminate = closure;
+}
+
+// Enumerates all stable matchings one at a time. The closed sets of rotations
+// are visited in lexicographic order of their indicator vectors, and each
+// step eliminates or restores only the rotations whose indicator changes.
+class StableMatchingEnumerator {
+public:
+    // proposals and engagements hold the proposer-optimal matching of a
+    // market with M proposers and N reviewers
+    template <typename Iter>
+    StableMatchingEnumerator(const RotationPoset& poset, Iter proposals, Iter engagements, const std::size_t M, const std::size_t N) :
+        poset(poset), proposals(proposals, proposals + M), engagements(engagements, engagements + N),
+        eliminated(poset.size(), 0), missing(poset.size(), 0), started(false) {
+
+        // the rotations that come right after each rotation
+        const std::size_t R = poset.size();
+        succPtr.assign(R + 1, 0);
+        for (std::size_t kX = 0; kX < poset.pred.size(); kX++) {
+            succPtr[poset.pred[kX] + 1]++;
+        }
+        for (std::size_t rX = 0; rX < R; rX++) {
+            succPtr[rX + 1] += succPtr[rX];
+            missing[rX] = poset.predPtr[rX + 1] - poset.predPtr[rX];
+        }
+        succ.resize(poset.pred.size());
+        std::vector<std::size_t> fill(succPtr.begin(), succPtr.end() - 1);
+        for (std::size_t rX = 0; rX < R; rX++) {
+            for (std::size_t kX = poset.predPtr[rX]; kX < poset.predPtr[rX + 1]; kX++) {
+                succ[fill[poset.pred[kX]]++] = rX;
+            }
+        }
+    }
+
+    // writes the next stable matching to proposals and engagements; returns
+    // false once all stable matchings have been visited
+    template <typename Iter>
+    bool next(Iter proposalsOut, Iter engagementsOut) {
+        if (!started) {
+            started = true;
+        } else {
+            // find the last rotation that is not eliminated but could be, and
+            // restore all rotations after it
+            std::size_t rX = poset.size();
+            for (;;) {
+                if (rX == 0) {
+                    return false;
+                }
+                rX--;
+                if (eliminated[rX]) {
+                    toggle(rX);
+                } else if (missing[rX] == 0) {
+                    toggle(rX);
+                    break;
+                }
+            }
+        }
+        std::copy(proposals.begin(), proposals.end(), proposalsOut);
+        std::copy(engagements.begin(), engagements.end(), engagementsOut);
+        return true;
+    }
+
+private:
+    const RotationPoset poset;
+    std::vector<std::size_t> proposals, engagements;
+    std::vector<std::size_t> succPtr, succ;
+    std::vector<char> eliminated;
+
+    // number of predecessors of each rotation that have not been eliminated
+    std::vector<std::size_t> missing;
+    bool started;
+
+    // eliminates or restores a rotation
+    void toggle(const std::size_t rX) {
+        const bool restore = eliminated[rX] != 0;
+        for (std::size_t kX = poset.ptr[rX]; kX < poset.ptr[rX + 1]; kX++) {
+            const std::size_t kNext = kX + 1 < poset.ptr[rX + 1] ? kX + 1 : poset.ptr[rX];
+            const std::size_t wX = restore ? poset.reviewers[kX] : poset.reviewers[kNext];
+            proposals[poset.proposers[kX]] = wX;
+            engagements[wX] = poset.proposers[kX];
+        }
+        eliminated[rX] = !restore;
+        for (std::size_t kX = succPtr[rX]; kX < succPtr[rX + 1]; kX++) {
+            if (restore) {
+                missing[succ[kX]]++;
+            } else {
+                missing[succ[kX]]--;
+            }
+        }
+    }
+};
+
+}
+
+#endif
@@ -0,0 +1,229 @@
+//  matchingR -- Matching Algorithms in R and C++
+//
+//  Copyright (C) 2015  Jan Tilly <jtilly@econ.upenn.edu>
+//                      Nick Janetos <njanetos@econ.upenn.edu>
+//
+//  This file is part of matchingR.
+//
+//  matchingR is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation, either version 2 of the License, or
+//  (at your option) any later version.
+//
+//  matchingR is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+
+#ifndef matchingR_lottery_h
+#define matchingR_lottery_h
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <random>
+#include <vector>
+
+#include "galeshapley.h"
+#include "matrix.h"
+
+namespace matchingR {
+
+// How ties in the reviewers' priorities are broken. With single tie-breaking,
+// every proposer draws one lottery number that all reviewers use. With
+// multiple tie-breaking, every reviewer draws her own lottery.
+enum TieBreaking { SINGLE_TIE_BREAKING, MULTIPLE_TIE_BREAKING };
+
+// The reviewers' weak orders over the proposers. Column j of order lists the
+// proposers from reviewer j's highest to her lowest priority class, and
+// element (i, j) of classStart is the position in this column at which the
+// class of proposer i begins. Any strict order that breaks the ties puts
+// proposer i at position classStart(i, j) or later, but before the next
+// class.
+struct WeakOrders {
+    Matrix<std::size_t> order, classStart;
+};
+
+// Builds the weak orders from priority classes. With M proposers and N
+// reviewers, reviewerClasses is M by N and element (i, j) is the priority
+// class of proposer i at reviewer j (lower is better). Proposers in the same
+// class are tied.
+template <typename Classes>
+void weakOrders(const Classes& reviewerClasses, WeakOrders& weak) {
+
+    // number of proposers (men)
+    const std::size_t M = reviewerClasses.n_rows;
+
+    // number of reviewers (women)
+    const std::size_t N = reviewerClasses.n_cols;
+
+    weak.order.set_size(M, N);
+    weak.classStart.set_size(M, N);
+
+    #pragma omp parallel
+    {
+        std::vector<std::size_t> column(M);
+
+        #pragma omp for schedule(static)
+        for (std::size_t wX = 0; wX < N; wX++) {
+            for (std::size_t iX = 0; iX < M; iX++) {
+                column[iX] = iX;
+            }
+            std::stable_sort(column.begin(), column.end(), [&](const std::size_t a, const std::size_t b) {
+                return reviewerClasses(a, wX) < reviewerClasses(b, wX);
+            });
+
+            std::size_t start = 0;
+            for (std::size_t kX = 0; kX < M; kX++) {
+                if (kX > 0 && reviewerClasses(column[kX - 1], wX) < reviewerClasses(column[kX], wX)) {
+                    start = kX;
+                }
+                weak.order(kX, wX) = column[kX];
+                weak.classStart(column[kX], wX) = start;
+            }
+        }
+    }
+}
+
+// buffers of breakTies that can be reused across draws
+struct TieBreakingScratch {
+    std::vector<std::size_t> lottery, next;
+};
+
+// A uniform random integer in [0, n). The bias of the modulo is below
+// n / 2^64 and thus negligible.
+inline std::size_t uniformIndex(std::mt19937_64& rng, const std::size_t n) {
+    return static_cast<std::size_t>(rng() % n);
+}
+
+// Draws a strict order for every reviewer that refines her weak order, where
+// the ties are broken by a single lottery or by one lottery per reviewer.
+// Writes the position of proposer i in reviewer j's strict order to element
+// (i, j) of reviewerRanks (M by N), as galeShapleyMatchingOrdinal expects.
+// The weak orders are only read, so that several threads can share them.
+// Takes time proportional to the size of the tables.
+template <typename Ranks>
+void breakTies(const WeakOrders& weak, const TieBreaking tieBreaking, std::mt19937_64& rng, Ranks& reviewerRanks, TieBreakingScratch& scratch) {
+
+    // number of proposers (men)
+    const std::size_t M = weak.order.n_rows;
+
+    // number of reviewers (women)
+    const std::size_t N = weak.order.n_cols;
+
+    std::vector<std::size_t>& lottery = scratch.lottery;
+    std::vector<std::size_t>& next = scratch.next;
+    lottery.resize(M);
+    next.resize(M);
+
+    if (tieBreaking == SINGLE_TIE_BREAKING) {
+
+        // a random order of all proposers
+        for (std::size_t iX = 0; iX < M; iX++) {
+            lottery[iX] = iX;
+        }
+        for (std::size_t iX = M; iX-- > 1; ) {
+            std::swap(lottery[iX], lottery[uniformIndex(rng, iX + 1)]);
+        }
+
+        // every reviewer fills the positions of each class in the order of
+        // the lottery; next holds the next free position of the class that
+        // starts at this position
+        for (std::size_t wX = 0; wX < N; wX++) {
+            for (std::size_t kX = 0; kX < M; kX++) {
+                next[kX] = kX;
+            }
+            for (std::size_t kX = 0; kX < M; kX++) {
+                const std::size_t iX = lottery[kX];
+                reviewerRanks(iX, wX) = next[weak.classStart(iX, wX)]++;
+            }
+        }
+
+    } else {
+
+        // shuffle every class of every reviewer independently (Fisher-Yates
+        // from the back; each proposer is swapped with a random proposer of
+        // his class that comes before him)
+        for (std::size_t wX = 0; wX < N; wX++) {
+            for (std::size_t kX = 0; kX < M; kX++) {
+                lottery[kX] = weak.order(kX, wX);
+            }
+            for (std::size_t kX = M; kX-- > 0; ) {
+                const std::size_t start = weak.classStart(lottery[kX], wX);
+                std::swap(lottery[kX], lottery[start + uniformIndex(rng, kX - start + 1)]);
+            }
+            for (std::size_t kX = 0; kX < M; kX++) {
+                reviewerRanks(lottery[kX], wX) = kX;
+            }
+        }
+    }
+}
+
+// Estimates how likely each proposer is to be matched to each reviewer when
+// the ties in the reviewers' priorities are broken at random. Runs deferred
+// acceptance for the given number of draws of the lottery. proposerPref is N
+// by M as in galeShapleyMatching. On exit, counts is N + 1 by M and element
+// (j, i) is the number of draws in which proposer i was matched to reviewer j,
+// where j = N means unmatched.
+//
+// Draw d uses its own random number generator that is seeded with seed and d,
+// so that the counts do not depend on the number of threads or the schedule.
+// The weak orders are shared by all threads. Each thread keeps its own table
+// of ranks of type Index, which needs to hold values up to M - 1, and its own
+// counts, which are added up at the end. Compile with OpenMP to use more than
+// one thread.
+template <typename Index, typename Pref>
+void lotteryAssignments(const Pref& proposerPref, const WeakOrders& weak, const TieBreaking tieBreaking,
+                        const std::uint64_t seed, const std::size_t draws, Matrix<std::size_t>& counts) {
+
+    // number of proposers (men)
+    const std::size_t M = proposerPref.n_cols;
+
+    // number of reviewers (women)
+    const std::size_t N = proposerPref.n_rows;
+
+    counts.set_size(N + 1, M);
+    counts.fill(0);
+
+    #pragma omp parallel
+    {
+        // buffers of this thread
+        Matrix<Index> reviewerRanks;
+        reviewerRanks.set_size(M, N);
+        TieBreakingScratch tieBreakingScratch;
+        GaleShapleyScratch scratch;
+        std::vector<std::size_t> proposals(M), engagements(N);
+
+        Matrix<std::size_t> threadCounts;
+        threadCounts.set_size(N + 1, M);
+        threadCounts.fill(0);
+
+        #pragma omp for schedule(dynamic)
+        for (std::size_t dX = 0; dX < draws; dX++) {
+
+            std::seed_seq seq{static_cast<std::uint32_t>(seed), static_cast<std::uint32_t>(seed >> 32),
+                              static_cast<std::uint32_t>(dX), static_cast<std::uint32_t>(static_cast<std::uint64_t>(dX) >> 32)};
+            std::mt19937_64 rng(seq);
+
+            breakTies(weak, tieBreaking, rng, reviewerRanks, tieBreakingScratch);
+            galeShapleyMatchingOrdinal(proposerPref, reviewerRanks, proposals.begin(), engagements.begin(), scratch);
+
+            for (std::size_t iX = 0; iX < M; iX++) {
+                threadCounts(proposals[iX], iX)++;
+            }
+        }
+
+        #pragma omp critical
+        {
+            for (std::size_t iX = 0; iX < M; iX++) {
+                for (std::size_t wX = 0; wX <= N; wX++) {
+                    counts(wX, iX) += threadCounts(wX, iX);
+                }
+            }
+        }
+    }
+}
+
+}
+
+#endif
@@ -0,0 +1,78 @@
+//  matchingR -- Matching Algorithms in R and C++
+//
+//  Copyright (C) 2015  Jan Tilly <jtilly@econ.upenn.edu>
+//                      Nick Janetos <njanetos@econ.upenn.edu>
+//
+//  This file is part of matchingR.
+//
+//  matchingR is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation, either version 2 of the License, or
+//  (at your option) any later version.
+//
+//  matchingR is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+
+#ifndef matchingR_matrix_h
+#define matchingR_matrix_h
+
+#include <cstddef>
+#include <vector>
+
+namespace matchingR {
+
+// A read-only view of a column-major matrix of indices that is owned by
+// someone else, e.g. an R integer or numeric matrix or a std::vector. Elements
+// are converted to std::size_t when they are read.
+//
+// The algorithms in this directory accept any matrix type that provides
+// n_rows, n_cols, and operator()(i, j), such as this view, Matrix below, or an
+// Armadillo matrix.
+template <typename T>
+class MatrixView {
+public:
+    const std::size_t n_rows;
+    const std::size_t n_cols;
+    const std::size_t n_elem;
+
+    MatrixView(const T* mem, const std::size_t n_rows, const std::size_t n_cols) :
+        n_rows(n_rows), n_cols(n_cols), n_elem(n_rows * n_cols), mem(mem) {}
+
+    std::size_t operator()(const std::size_t i, const std::size_t j) const { return static_cast<std::size_t>(mem[i + j * n_rows]); }
+    std::size_t operator()(const std::size_t i) const { return static_cast<std::size_t>(mem[i]); }
+    std::size_t at(const std::size_t i, const std::size_t j) const { return static_cast<std::size_t>(mem[i + j * n_rows]); }
+    const T* colptr(const std::size_t j) const { return mem + j * n_rows; }
+
+private:
+    const T* mem;
+};
+
+// A column-major matrix that owns its memory. The algorithms use it for their
+// internal tables, so that they do not depend on Armadillo.
+template <typename T>
+class Matrix {
+public:
+    std::size_t n_rows = 0;
+    std::size_t n_cols = 0;
+
+    void set_size(const std::size_t rows, const std::size_t cols) {
+        n_rows = rows;
+        n_cols = cols;
+        mem.resize(rows * cols);
+    }
+    void fill(const T value) { mem.assign(mem.size(), value); }
+
+    T& operator()(const std::size_t i, const std::size_t j) { return mem[i + j * n_rows]; }
+    const T& operator()(const std::size_t i, const std::size_t j) const { return mem[i + j * n_rows]; }
+    T* colptr(const std::size_t j) { return mem.data() + j * n_rows; }
+    const T* colptr(const std::size_t j) const { return mem.data() + j * n_rows; }
+
+private:
+    std::vector<T> mem;
+};
+
+}
+
+#endif
@@ -0,0 +1,349 @@
+//  matchingR -- Matching Algorithms in R and C++
+//
+//  Copyright (C) 2015  Jan Tilly <jtilly@econ.upenn.edu>
+//                      Nick Janetos <njanetos@econ.upenn.edu>
+//
+//  This file is part of matchingR.
+//
+//  matchingR is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation, either version 2 of the License, or
+//  (at your option) any later version.
+//
+//  matchingR is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+
+// A binary file format for the preferences of one side of a market, so that
+// very large markets can be solved directly from memory-mapped files.
+//
+// A file starts with a header of 64 bytes (PreferenceFileHeader), which is
+// followed by the data:
+//
+//   dense  n_rows * n_cols indices in column-major order. Column j contains
+//          j's preference order (content PREFERENCE_ORDERS) or the rank that
+//          j assigns to each agent on the other side (content RANKS).
+//   csr    n_cols + 1 offsets (uint64) followed by nnz indices. The
+//          preference list of j is stored in positions ptr[j], ..., ptr[j+1]-1.
+//          n_rows is the number of agents on the other side.
+//
+// Indices are unsigned integers of index_bytes bytes (2, 4, or 8).
+//
+// All fields are stored in the byte order of the machine that wrote the file,
+// so that the data can be read in place. The header field byte_order holds
+// PREFERENCE_FILE_BYTE_ORDER, and files that were written with the other byte
+// order are rejected.
+
+#ifndef matchingR_preffile_h
+#define matchingR_preffile_h
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#ifdef _WIN32
+// keep windows.h from defining the min and max macros, which break std::min,
+// std::max and std::numeric_limits<T>::max in code that includes this header
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include "matrix.h"
+
+namespace matchingR {
+
+enum PreferenceContent { PREFERENCE_ORDERS = 0, RANKS = 1 };
+enum PreferenceLayout { DENSE = 0, CSR = 1 };
+
+struct PreferenceFileHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t content;
+    uint32_t layout;
+    uint32_t index_bytes;
+    uint64_t n_rows;
+    uint64_t n_cols;
+    uint64_t nnz;
+    uint64_t data_offset;
+    uint64_t byte_order;
+};
+
+static const char PREFERENCE_FILE_MAGIC[8] = {'M', 'A', 'T', 'C', 'H', 'P', 'R', 'F'};
+static const uint32_t PREFERENCE_FILE_VERSION = 1;
+static const uint64_t PREFERENCE_FILE_BYTE_ORDER = 0x0102030405060708ULL;
+static const uint64_t PREFERENCE_FILE_SWAPPED_BYTE_ORDER = 0x0807060504030201ULL;
+
+// smallest index width (in bytes) that can hold every index below n
+inline uint32_t preferenceIndexBytes(const uint64_t n) {
+    return n <= UINT16_MAX ? 2 : (n <= UINT32_MAX ? 4 : 8);
+}
+
+// A read-only memory map of a preference file. The header is checked when the
+// file is opened; a std::runtime_error is thrown if it is not a valid file.
+class PreferenceFile {
+public:
+    explicit PreferenceFile(const std::string& path) : data(NULL), length(0) {
+#ifdef _WIN32
+        file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+        if (file == INVALID_HANDLE_VALUE) {
+            throw std::runtime_error("Cannot open preference file " + path + ".");
+        }
+        LARGE_INTEGER size;
+        GetFileSizeEx(file, &size);
+        length = static_cast<std::size_t>(size.QuadPart);
+        mapping = length > 0 ? CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL) : NULL;
+        if (mapping != NULL) {
+            data = static_cast<const unsigned char*>(MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0));
+        }
+#else
+        const int fd = open(path.c_str(), O_RDONLY);
+        if (fd < 0) {
+            throw std::runtime_error("Cannot open preference file " + path + ".");
+        }
+        struct stat st;
+        if (fstat(fd, &st) == 0 && st.st_size > 0) {
+            length = static_cast<std::size_t>(st.st_size);
+            void* mem = mmap(NULL, length, PROT_READ, MAP_SHARED, fd, 0);
+            data = mem == MAP_FAILED ? NULL : static_cast<const unsigned char*>(mem);
+        }
+        // the mapping stays valid after the descriptor is closed
+        close(fd);
+#endif
+        if (data == NULL && length >= sizeof(PreferenceFileHeader)) {
+            unmap();
+            throw std::runtime_error("Cannot map preference file " + path + " into memory.");
+        }
+        try {
+            check(path);
+        } catch (...) {
+            unmap();
+            throw;
+        }
+    }
+
+    ~PreferenceFile() { unmap(); }
+
+    const PreferenceFileHeader& header() const { return head; }
+
+    // the indices of a dense file; T must be an unsigned integer type of
+    // header().index_bytes bytes
+    template <typename T>
+    MatrixView<T> dense() const {
+        return MatrixView<T>(reinterpret_cast<const T*>(data + head.data_offset), head.n_rows, head.n_cols);
+    }
+
+    // the offsets and the indices of a CSR file as column vectors
+    MatrixView<uint64_t> ptr() const {
+        return MatrixView<uint64_t>(reinterpret_cast<const uint64_t*>(data + sizeof(PreferenceFileHeader)), head.n_cols + 1, 1);
+    }
+    template <typename T>
+    MatrixView<T> idx() const {
+        return MatrixView<T>(reinterpret_cast<const T*>(data + head.data_offset), head.nnz, 1);
+    }
+
+private:
+    PreferenceFile(const PreferenceFile&);
+    PreferenceFile& operator=(const PreferenceFile&);
+
+    void check(const std::string& path) {
+        if (length < sizeof(PreferenceFileHeader)) {
+            throw std::runtime_error(path + " is not a preference file.");
+        }
+        std::memcpy(&head, data, sizeof(PreferenceFileHeader));
+        if (std::memcmp(head.magic, PREFERENCE_FILE_MAGIC, sizeof(head.magic)) != 0) {
+            throw std::runtime_error(path + " is not a preference file.");
+        }
+        if (head.byte_order == PREFERENCE_FILE_SWAPPED_BYTE_ORDER) {
+            throw std::runtime_error(path + " was written on a machine with a different byte order.");
+        }
+        if (head.byte_order != PREFERENCE_FILE_BYTE_ORDER) {
+            throw std::runtime_error(path + " has an invalid header.");
+        }
+        if (head.version != PREFERENCE_FILE_VERSION) {
+            throw std::runtime_error(path + " has an unsupported version.");
+        }
+        if (head.content > RANKS || head.layout > CSR ||
+            (head.index_bytes != 2 && head.index_bytes != 4 && head.index_bytes != 8)) {
+            throw std::runtime_error(path + " has an invalid header.");
+        }
+
+        // size of the data that the header announces
+        if (head.layout == CSR && (head.n_cols >= length / 8 || head.nnz > length)) {
+            throw std::runtime_error(path + " is truncated or has an invalid header.");
+        }
+        const uint64_t offsets = head.layout == CSR ? 8 * (head.n_cols + 1) : 0;
+        const uint64_t entries = head.layout == CSR ? head.nnz : head.n_rows * head.n_cols;
+        if ((head.layout == DENSE && head.n_cols > 0 && head.n_rows > UINT64_MAX / 8 / head.n_cols) ||
+            head.data_offset != sizeof(PreferenceFileHeader) + offsets ||
+            length < head.data_offset + entries * head.index_bytes) {
+            throw std::runtime_error(path + " is truncated or has an invalid header.");
+        }
+
+        if (head.layout == CSR) {
+            const MatrixView<uint64_t> p = ptr();
+            if (p(0) != 0 || p(head.n_cols) != head.nnz) {
+                throw std::runtime_error(path + " has invalid offsets.");
+            }
+            for (uint64_t j = 0; j < head.n_cols; j++) {
+                if (p(j + 1) < p(j)) {
+                    throw std::runtime_error(path + " has invalid offsets.");
+                }
+            }
+        }
+    }
+
+    void unmap() {
+#ifdef _WIN32
+        if (data != NULL) { UnmapViewOfFile(data); }
+        if (mapping != NULL) { CloseHandle(mapping); }
+        if (file != INVALID_HANDLE_VALUE) { CloseHandle(file); }
+        mapping = NULL;
+        file = INVALID_HANDLE_VALUE;
+#else
+        if (data != NULL) { munmap(const_cast<unsigned char*>(data), length); }
+#endif
+        data = NULL;
+    }
+
+    const unsigned char* data;
+    std::size_t length;
+    PreferenceFileHeader head;
+#ifdef _WIN32
+    HANDLE file, mapping;
+#endif
+};
+
+// Calls f with a view of the indices of a dense file, using the index type of
+// the file.
+template <typename F>
+auto withDenseView(const PreferenceFile& file, F f) -> decltype(f(file.dense<uint64_t>())) {
+    if (file.header().index_bytes == 2) {
+        return f(file.dense<uint16_t>());
+    }
+    if (file.header().index_bytes == 4) {
+        return f(file.dense<uint32_t>());
+    }
+    return f(file.dense<uint64_t>());
+}
+
+// Calls f with views of the offsets and the indices of a CSR file.
+template <typename F>
+auto withCSRView(const PreferenceFile& file, F f) -> decltype(f(file.ptr(), file.idx<uint64_t>())) {
+    if (file.header().index_bytes == 2) {
+        return f(file.ptr(), file.idx<uint16_t>());
+    }
+    if (file.header().index_bytes == 4) {
+        return f(file.ptr(), file.idx<uint32_t>());
+    }
+    return f(file.ptr(), file.idx<uint64_t>());
+}
+
+// Writes the header and the data of a preference file. column(j, out) must
+// append the indices of column j to out.
+template <typename T, typename Column>
+void writePreferenceFile(const std::string& path, const PreferenceContent content, const PreferenceLayout layout,
+                         const uint64_t nRows, const uint64_t nCols, const std::vector<uint64_t>& ptr,
+                         Column column) {
+
+    FILE* out = std::fopen(path.c_str(), "wb");
+    if (out == NULL) {
+        throw std::runtime_error("Cannot open " + path + " for writing.");
+    }
+
+    PreferenceFileHeader head;
+    std::memset(&head, 0, sizeof(head));
+    std::memcpy(head.magic, PREFERENCE_FILE_MAGIC, sizeof(head.magic));
+    head.version = PREFERENCE_FILE_VERSION;
+    head.content = content;
+    head.layout = layout;
+    head.index_bytes = sizeof(T);
+    head.n_rows = nRows;
+    head.n_cols = nCols;
+    head.nnz = layout == CSR ? ptr.back() : nRows * nCols;
+    head.data_offset = sizeof(PreferenceFileHeader) + (layout == CSR ? 8 * ptr.size() : 0);
+    head.byte_order = PREFERENCE_FILE_BYTE_ORDER;
+
+    // if a column cannot be written, the file is closed and removed, so that
+    // no truncated file is left behind
+    bool ok = std::fwrite(&head, sizeof(head), 1, out) == 1;
+    try {
+        if (layout == CSR) {
+            ok = ok && std::fwrite(ptr.data(), sizeof(uint64_t), ptr.size(), out) == ptr.size();
+        }
+        std::vector<T> buffer;
+        for (uint64_t j = 0; ok && j < nCols; j++) {
+            buffer.clear();
+            column(j, buffer);
+            ok = std::fwrite(buffer.data(), sizeof(T), buffer.size(), out) == buffer.size();
+        }
+    } catch (...) {
+        std::fclose(out);
+        std::remove(path.c_str());
+        throw;
+    }
+    ok = std::fclose(out) == 0 && ok;
+    if (!ok) {
+        std::remove(path.c_str());
+        throw std::runtime_error("Cannot write " + path + ".");
+    }
+}
+
+// Writes the column-major matrix pref of preference orders as a dense file.
+// If ranks is true, the ranks that each column assigns to the agents on the
+// other side are written instead, which requires every column to be a
+// permutation of 0, ..., pref.n_rows - 1. T must be able to hold pref.n_rows.
+template <typename T, typename Pref>
+void writeDensePreferences(const std::string& path, const Pref& pref, const bool ranks) {
+    const std::size_t n = pref.n_rows;
+    writePreferenceFile<T>(path, ranks ? RANKS : PREFERENCE_ORDERS, DENSE, n, pref.n_cols, std::vector<uint64_t>(),
+                           [&](const uint64_t j, std::vector<T>& out) {
+        // n marks agents that have not been ranked yet
+        out.assign(n, static_cast<T>(n));
+        for (std::size_t i = 0; i < n; i++) {
+            if (!ranks) {
+                out[i] = static_cast<T>(pref(i, j));
+            } else if (pref(i, j) < n && out[pref(i, j)] == n) {
+                out[pref(i, j)] = static_cast<T>(i);
+            } else {
+                throw std::runtime_error("Ranks can only be written for complete preference orders.");
+            }
+        }
+    });
+}
+
+// Writes preference lists in compressed sparse row format: the list of j is
+// stored in idx(ptr(j)), ..., idx(ptr(j + 1) - 1) and refers to nOther agents
+// on the other side.
+template <typename T, typename Ptr, typename Idx>
+void writeSparsePreferences(const std::string& path, const Ptr& ptr, const Idx& idx, const uint64_t nOther) {
+    const std::size_t nCols = ptr.n_elem - 1;
+    std::vector<uint64_t> offsets(nCols + 1);
+    for (std::size_t j = 0; j <= nCols; j++) {
+        offsets[j] = ptr(j);
+    }
+    writePreferenceFile<T>(path, PREFERENCE_ORDERS, CSR, nOther, nCols, offsets,
+                           [&](const uint64_t j, std::vector<T>& out) {
+        for (uint64_t k = offsets[j]; k < offsets[j + 1]; k++) {
+            out.push_back(static_cast<T>(idx(k)));
+        }
+    });
+}
+
+}
+
+#endif
@@ -0,0 +1,662 @@
+//  matchingR -- Matching Algorithms in R and C++
+//
+//  Copyright (C) 2015  Jan Tilly <jtilly@econ.upenn.edu>
+//                      Nick Janetos <njanetos@econ.upenn.edu>
+//
+//  This file is part of matchingR.
+//
+//  matchingR is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation, either version 2 of the License, or
+//  (at your option) any later version.
+//
+//  matchingR is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+
+#ifndef matchingR_roommate_h
+#define matchingR_roommate_h
+
+#include <cstddef>
+#include <queue>
+#include <vector>
+
+#include "matrix.h"
+#include "statistics.h"
+
+namespace matchingR {
+
+// buffers used by irvingMatching, so that they can be reused across markets.
+// Index must be able to hold N + 1.
+template <typename Index>
+struct IrvingScratch {
+    Matrix<Index> rank, next, prev;
+    std::vector<Index> proposal_to, proposal_from, proposed_to;
+    std::vector<Index> first, last, size, in_index;
+    std::vector<Index> x, index, active;
+    Statistics statistics;
+};
+
+// Fills rank(j, n) with the position of j in n's preferences (lower is
+// better). pref is N-1 by N and its column n lists everyone but n in the order
+// of n's preferences. Returns false if the preferences of some individual are not a
+// permutation of all other individuals.
+template <typename Pref, typename Index>
+bool roommateRanks(const Pref& pref, Matrix<Index>& rank) {
+
+    // Number of participants
+    const std::size_t N = pref.n_cols;
+
+    rank.set_size(N, N);
+    rank.fill(N);
+    for (std::size_t n = 0; n < N; n++) {
+        for (std::size_t i = 0; i < pref.n_rows; i++) {
+            if (pref(i, n) >= N || pref(i, n) == n || rank(pref(i, n), n) != N) {
+                return false;
+            }
+            rank(pref(i, n), n) = i;
+        }
+    }
+
+    return true;
+}
+
+// Phase 2 of Irving's algorithm: eliminates rotations from stable tables until
+// every table holds at most one entry. size holds the sizes of the N tables,
+// second(p) returns the second entry of p's table, last(m) returns the last
+// entry of m's table, and reduce(m) deletes the last entry of m's table and m
+// from the table of that individual, or returns false if this shows that no
+// stable matching exists. x, index, in_index, and active are buffers. Returns
+// false if no stable matching exists.
+//
+// A 'rotation' is a series of individuals and preference pairs which satisfy
+// a relationship specified in Irving (1985). Removing a rotation maintains the
+// status of the table as a 'stable' table, meaning everyone's most preferred
+// feasible option hates them. Rotations are found by following a path p_0,
+// p_1, ... of individuals whose tables hold more than one entry, where x_{i+1}
+// is the second entry in p_i's table and p_{i+1} is the last entry in
+// x_{i+1}'s table. Once the path runs into itself, its cycle is a rotation.
+//
+// As in the original implementation of the package, the individuals with more
+// than one entry take turns in the order of their indices, and each of them
+// eliminates the rotation that the path from him leads to, so that the same
+// stable matching is found. Eliminating a rotation does not change the part of
+// the path before the cycle (Gusfield and Irving, 1989), so the path is kept
+// and continued for as long as the next individual in turn is on it, and is
+// only rebuilt from the next individual otherwise.
+template <typename Index, typename Second, typename Last, typename Reduce>
+bool eliminateRotations(const std::vector<Index>& size, Second second, Last last, Reduce reduce,
+                        std::vector<Index>& x, std::vector<Index>& index,
+                        std::vector<Index>& in_index, std::vector<Index>& active,
+                        Statistics& statistics) {
+
+    // Number of participants
+    const std::size_t N = size.size();
+
+    // position of each individual in index plus one (zero if not in index)
+    x.clear();
+    index.clear();
+    in_index.assign(N, 0);
+
+    // drops the individuals from position to onwards from the path
+    auto truncate = [&](const std::size_t to) {
+        for (std::size_t i = to; i < index.size(); i++) {
+            in_index[index[i]] = 0;
+        }
+        x.resize(to);
+        index.resize(to);
+    };
+
+    // the individuals that may have more than one entry left form a circular
+    // list in the order of their indices, active[n] follows n
+    std::size_t before = N, head = N;
+    active.resize(N);
+    for (std::size_t n = 0; n < N; n++) {
+        if (size[n] > 1) {
+            if (before == N) { head = n; } else { active[before] = n; }
+            before = n;
+        }
+    }
+    if (before == N) {
+        return true;
+    }
+    active[before] = head;
+
+    while (true) {
+
+        // skip and drop individuals that are left with only one entry
+        const std::size_t n = active[before];
+        if (size[n] <= 1) {
+            if (n == before) {
+                break;
+            }
+            active[before] = active[n];
+            continue;
+        }
+        before = n;
+
+        // if n is not on the path, a new path from n starts on top of it at
+        // position base
+        std::size_t base = 0;
+        if (in_index[n] == 0) {
+            base = index.size();
+            x.push_back(N);
+            index.push_back(n);
+            in_index[n] = index.size();
+        }
+
+        std::size_t rot_tail;
+        while (true) {
+            const std::size_t new_x = second(index.back());
+            const std::size_t new_index = last(new_x);
+
+            if (in_index[new_index] == 0) {
+                x.push_back(new_x);
+                index.push_back(new_index);
+                in_index[new_index] = index.size();
+                continue;
+            }
+
+            // Check for a rotation
+            rot_tail = in_index[new_index] - 1;
+            if (rot_tail >= base) {
+                x.push_back(new_x);
+                index.push_back(new_index);
+                break;
+            }
+
+            // the new path runs into the old one, which therefore leads to
+            // the same rotation
+            truncate(base);
+            base = 0;
+        }
+
+        // Delete the rotation
+        statistics.rotation();
+        for (std::size_t i = rot_tail + 1; i < index.size(); i++) {
+            while (last(x[i]) != index[i-1]) {
+                if (!reduce(x[i])) { return false; }
+            }
+        }
+
+        // Remove the rotation from the path. If it was found on a new path,
+        // the new path replaces the old one, which may have been changed by
+        // the elimination.
+        truncate(rot_tail);
+        if (base > 0) {
+            for (std::size_t i = 0; i < base; i++) {
+                in_index[index[i]] = 0;
+            }
+            x.erase(x.begin(), x.begin() + base);
+            index.erase(index.begin(), index.begin() + base);
+            for (std::size_t i = 0; i < index.size(); i++) {
+                in_index[index[i]] = i + 1;
+            }
+        }
+
+        // Remove the individuals at the end of the path that are left with
+        // only one entry
+        while (!index.empty() && size[index.back()] <= 1) {
+            truncate(index.size() - 1);
+        }
+    }
+
+    return true;
+}
+
+// Irving's algorithm. scratch.rank must have been filled by roommateRanks.
+// matchings is a random access iterator to N elements. Returns false and a
+// vector of zeros if no stable matching exists.
+template <typename Pref, typename Iter, typename Index>
+bool irvingMatching(const Pref& pref, Iter matchings, IrvingScratch<Index>& scratch) {
+
+    // Number of participants
+    const std::size_t N = pref.n_cols;
+
+    // Empty matchings (returned as zeros if no stable matching exists)
+    for (std::size_t n = 0; n < N; n++) {
+        matchings[n] = 0;
+    }
+
+    const Matrix<Index>& rank = scratch.rank;
+    std::vector<Index>& proposal_to = scratch.proposal_to;
+    std::vector<Index>& proposal_from = scratch.proposal_from;
+    std::vector<Index>& proposed_to = scratch.proposed_to;
+    Statistics& statistics = scratch.statistics;
+
+    // All participants begin unmatched having proposals accepted by nobody (=N)...
+    proposal_to.assign(N, N);
+    // having accepted proposals from nobody (=N)...
+    proposal_from.assign(N, N);
+    // and having proposed to nobody.
+    proposed_to.assign(N, 0);
+
+    // Participants whose proposals are not held by anyone propose in the
+    // order of a queue. The outcome of phase 1 does not depend on this order,
+    // and every participant proposes to everyone at most once.
+    std::queue<std::size_t> proposers;
+    for (std::size_t n = 0; n < N; n++) {
+        proposers.push(n);
+    }
+
+    while (!proposers.empty()) {
+
+        const std::size_t n = proposers.front();
+        proposers.pop();
+
+        while (true) {
+            // n has been rejected by everyone
+            if (proposed_to[n] >= N-1) { return false; }
+
+            // find the player he is proposing to next and iterate n's
+            // proposal forward
+            const std::size_t proposee = pref(proposed_to[n]++, n);
+            statistics.proposal();
+
+            // if the next best guy likes him better than his current match
+            // (unmatched is N) he accepts
+            if (proposal_from[proposee] == N || rank(n, proposee) < rank(proposal_from[proposee], proposee)) {
+                // reject the proposee's original proposer's proposal, who
+                // has to propose again
+                if (proposal_from[proposee] != N) {
+                    proposal_to[proposal_from[proposee]] = N;
+                    proposers.push(proposal_from[proposee]);
+                    statistics.rejection();
+                }
+                // make and record the proposal
+                proposal_to[n] = proposee;
+                proposal_from[proposee] = n;
+                break;
+            }
+
+            // offer was rejected
+            statistics.rejection();
+        }
+    }
+
+    statistics.phase("phase 1");
+
+    // Generate tables. The table of n is a doubly linked list over the
+    // positions in n's preferences, so that any entry can be removed in
+    // constant time. NONE marks the ends of a list, REMOVED marks positions
+    // that are no longer part of the table.
+    const std::size_t NONE = N;
+    const std::size_t REMOVED = N + 1;
+    Matrix<Index>& next = scratch.next;
+    Matrix<Index>& prev = scratch.prev;
+    std::vector<Index>& first = scratch.first;
+    std::vector<Index>& last = scratch.last;
+    std::vector<Index>& size = scratch.size;
+    next.set_size(N - 1, N);
+    prev.set_size(N - 1, N);
+    first.resize(N);
+    last.resize(N);
+    size.resize(N);
+    for (std::size_t n = 0; n < N; n++) {
+        for (std::size_t i = 0; i < N - 1; i++) {
+            next(i, n) = i + 1 < N - 1 ? i + 1 : NONE;
+            prev(i, n) = i > 0 ? i - 1 : NONE;
+        }
+        first[n] = N > 1 ? 0 : NONE;
+        last[n] = N > 1 ? N - 2 : NONE;
+        size[n] = N - 1;
+    }
+
+    // removes the entry at position i from n's table
+    auto remove = [&](const std::size_t n, const std::size_t i) {
+        if (prev(i, n) == NONE) { first[n] = next(i, n); } else { next(prev(i, n), n) = next(i, n); }
+        if (next(i, n) == NONE) { last[n] = prev(i, n); } else { prev(next(i, n), n) = prev(i, n); }
+        prev(i, n) = REMOVED;
+        size[n]--;
+    };
+
+    // removes n from m's table, returns false if n is not in m's table
+    auto removeFrom = [&](const std::size_t m, const std::size_t n) {
+        if (prev(rank(n, m), m) == REMOVED) { return false; }
+        remove(m, rank(n, m));
+        return true;
+    };
+
+    // Delete entries we eliminated in round 1
+    for (std::size_t n = 0; n < N; n++) {
+        while (size[n] > 0 && pref(last[n], n) != proposal_from[n]) {
+            // find and erase from the table
+            if (!removeFrom(pref(last[n], n), n)) { return false; }
+            remove(n, last[n]);
+        }
+    }
+
+    // Eliminate rotations
+    auto second = [&](const std::size_t p) { return pref(next(first[p], p), p); };
+    auto lastEntry = [&](const std::size_t m) { return pref(last[m], m); };
+    auto reduce = [&](const std::size_t m) {
+        // m needs to be removed from the table of the last entry in m's
+        // table and vice versa.
+        if (!removeFrom(lastEntry(m), m)) { return false; }
+
+        // Check to see if there's only one element remaining (if so, no stable matching.)
+        if (size[m] == 1) { return false; }
+
+        remove(m, last[m]);
+        return true;
+    };
+    if (!eliminateRotations(size, second, lastEntry, reduce, scratch.x, scratch.index,
+                            scratch.in_index, scratch.active, statistics)) {
+        return false;
+    }
+
+    statistics.phase("phase 2");
+
+    // Check if anything is empty
+    for (std::size_t n = 0; n < N; n++) {
+        if (size[n] == 0) { return false; }
+    }
+
+    // Create the matchings
+    for (std::size_t n = 0; n < N; n++) {
+        matchings[n] = pref(first[n], n);
+    }
+
+    return true;
+}
+
+// The offsets of the columns of a dense N-1 by N preference matrix, so that the
+// matrix can be passed to roommateMirror and irvingMatchingSparse as
+// preference lists in compressed sparse row format without making a copy. The
+// matrix type needs to provide n_elem and linear indexing by operator()(k).
+class ColumnOffsets {
+public:
+    const std::size_t n_elem;
+
+    ColumnOffsets(const std::size_t n_rows, const std::size_t n_cols) : n_elem(n_cols + 1), n_rows(n_rows) {}
+
+    std::size_t operator()(const std::size_t i) const { return i * n_rows; }
+
+private:
+    const std::size_t n_rows;
+};
+
+// buffers used by roommateMirror and irvingMatchingSparse, so that they can be
+// reused across markets. Entries of a preference list are stored as their
+// positions within the list, so that Index only needs to be able to hold the
+// number of individuals plus one.
+template <typename Index>
+struct IrvingSparseScratch {
+    std::vector<Index> mirror, next, prev;
+    std::vector<Index> proposal_to, proposal_from, proposed_to;
+    std::vector<Index> first, last, size, in_index;
+    std::vector<Index> x, index, active;
+    std::vector<Index> transposed, transposedOwner;
+    std::vector<std::size_t> transposedPtr, position;
+    Statistics statistics;
+};
+
+// Finds for each entry of the preference lists the entry that lists the same
+// pair the other way round. The list of individual n is stored in elements
+// ptr(n) to ptr(n + 1) - 1 of idx. If entry k of n's list is m, then
+// scratch.mirror[k] is the position of n within m's list, or N if m does not
+// list n. Returns false if the offsets are not consistent or if a list refers
+// to an individual that does not exist, to its owner, or to someone twice.
+// Takes time proportional to the number of entries.
+template <typename Ptr, typename Idx, typename Index>
+bool roommateMirror(const Ptr& ptr, const Idx& idx, IrvingSparseScratch<Index>& scratch) {
+
+    if (ptr.n_elem == 0 || ptr(0) != 0 || ptr(ptr.n_elem - 1) != idx.n_elem) {
+        return false;
+    }
+
+    // Number of participants and entries
+    const std::size_t N = ptr.n_elem - 1;
+    const std::size_t E = idx.n_elem;
+    const std::size_t NONE = N;
+
+    // transpose the lists, so that everyone knows who lists him and where. A
+    // list with more than N - 1 entries names someone twice.
+    std::vector<std::size_t>& transposedPtr = scratch.transposedPtr;
+    transposedPtr.assign(N + 1, 0);
+    for (std::size_t n = 0; n < N; n++) {
+        if (ptr(n + 1) < ptr(n) || ptr(n + 1) - ptr(n) >= N) {
+            return false;
+        }
+        for (std::size_t k = ptr(n); k < ptr(n + 1); k++) {
+            if (idx(k) >= N || idx(k) == n) {
+                return false;
+            }
+            transposedPtr[idx(k) + 1]++;
+        }
+    }
+    for (std::size_t n = 0; n < N; n++) {
+        transposedPtr[n + 1] += transposedPtr[n];
+    }
+
+    std::vector<Index>& transposed = scratch.transposed;
+    std::vector<Index>& transposedOwner = scratch.transposedOwner;
+    std::vector<std::size_t>& position = scratch.position;
+    transposed.resize(E);
+    transposedOwner.resize(E);
+    position.assign(transposedPtr.begin(), transposedPtr.end() - 1);
+    for (std::size_t n = 0; n < N; n++) {
+        for (std::size_t k = ptr(n); k < ptr(n + 1); k++) {
+            const std::size_t pos = position[idx(k)]++;
+            transposed[pos] = k - ptr(n);
+            transposedOwner[pos] = n;
+        }
+    }
+
+    // position now holds the position of each individual in the current list
+    std::vector<Index>& mirror = scratch.mirror;
+    mirror.assign(E, NONE);
+    position.assign(N, NONE);
+    for (std::size_t n = 0; n < N; n++) {
+        for (std::size_t k = ptr(n); k < ptr(n + 1); k++) {
+            if (position[idx(k)] != NONE) {
+                return false;
+            }
+            position[idx(k)] = k - ptr(n);
+        }
+        for (std::size_t t = transposedPtr[n]; t < transposedPtr[n + 1]; t++) {
+            const std::size_t m = transposedOwner[t];
+            if (position[m] != NONE) {
+                mirror[ptr(m) + transposed[t]] = position[m];
+            }
+        }
+        for (std::size_t k = ptr(n); k < ptr(n + 1); k++) {
+            position[idx(k)] = NONE;
+        }
+    }
+
+    return true;
+}
+
+// Irving's algorithm for preference lists that may be incomplete, so that
+// some individuals can stay unmatched (Gusfield and Irving, 1989, Section
+// 4.5.2). This includes markets with an odd number of individuals. Two
+// individuals can only be matched if each of them lists the other.
+// scratch.mirror must have been filled by roommateMirror. matchings is a
+// random access iterator to N elements; unmatched individuals are matched to
+// N. Returns false and a vector of zeros if no stable matching exists.
+//
+// Phase 1 is deferred acceptance. Everyone whose proposal is held is matched
+// in every stable matching, and so is everyone who holds a proposal, so if
+// these two sets differ, no stable matching exists. Otherwise everyone else is
+// unmatched in every stable matching and phase 2 eliminates rotations as in
+// irvingMatching. The tables are doubly linked lists over the entries of the
+// preference lists, so that memory and the running time of phase 1 are
+// proportional to their total length, and every deletion from a table takes
+// constant time. Entries are referred to by their positions within their
+// lists.
+template <typename Ptr, typename Idx, typename Iter, typename Index>
+bool irvingMatchingSparse(const Ptr& ptr, const Idx& idx, Iter matchings, IrvingSparseScratch<Index>& scratch) {
+
+    // Number of participants and entries
+    const std::size_t N = ptr.n_elem - 1;
+    const std::size_t E = idx.n_elem;
+
+    // Empty matchings (returned as zeros if no stable matching exists)
+    for (std::size_t n = 0; n < N; n++) {
+        matchings[n] = 0;
+    }
+
+    // NONE marks a missing entry or the ends of a list, REMOVED marks entries
+    // that are no longer part of the table
+    const std::size_t NONE = N;
+    const std::size_t REMOVED = N + 1;
+
+    const std::vector<Index>& mirror = scratch.mirror;
+    std::vector<Index>& proposal_to = scratch.proposal_to;
+    std::vector<Index>& proposal_from = scratch.proposal_from;
+    std::vector<Index>& proposed_to = scratch.proposed_to;
+    Statistics& statistics = scratch.statistics;
+
+    // All participants begin with proposals accepted by nobody (=N), having
+    // accepted proposals from nobody (=NONE), and about to propose to the
+    // first entry of their lists.
+    proposal_to.assign(N, N);
+    proposal_from.assign(N, NONE);
+    proposed_to.assign(N, 0);
+
+    std::queue<std::size_t> proposers;
+    for (std::size_t n = 0; n < N; n++) {
+        proposers.push(n);
+    }
+
+    while (!proposers.empty()) {
+
+        const std::size_t n = proposers.front();
+        proposers.pop();
+
+        while (proposed_to[n] < ptr(n + 1) - ptr(n)) {
+
+            // the position of n in the proposee's list, positions that come
+            // first are preferred
+            const std::size_t k = ptr(n) + proposed_to[n]++;
+            const std::size_t l = mirror[k];
+
+            // the proposee does not find n acceptable
+            if (l == NONE) {
+                continue;
+            }
+
+            const std::size_t proposee = idx(k);
+            statistics.proposal();
+
+            // the proposee holds on to n if he likes n better than the
+            // proposal that he currently holds
+            if (proposal_from[proposee] == NONE || l < proposal_from[proposee]) {
+                if (proposal_from[proposee] != NONE) {
+                    const std::size_t rejected = idx(ptr(proposee) + proposal_from[proposee]);
+                    proposal_to[rejected] = N;
+                    proposers.push(rejected);
+                    statistics.rejection();
+                }
+                proposal_from[proposee] = l;
+                proposal_to[n] = proposee;
+                break;
+            }
+
+            statistics.rejection();
+        }
+    }
+
+    statistics.phase("phase 1");
+
+    // Everyone is either matched in every stable matching or in none
+    for (std::size_t n = 0; n < N; n++) {
+        if ((proposal_to[n] == N) != (proposal_from[n] == NONE)) {
+            return false;
+        }
+    }
+
+    // Generate tables. The table of n holds the entries of n's list from his
+    // proposee to his proposer, excluding pairs that the other individual
+    // deleted from his own table. next and prev are indexed by entries and
+    // hold positions within the same list, as do first and last.
+    std::vector<Index>& next = scratch.next;
+    std::vector<Index>& prev = scratch.prev;
+    std::vector<Index>& first = scratch.first;
+    std::vector<Index>& last = scratch.last;
+    std::vector<Index>& size = scratch.size;
+    next.resize(E);
+    prev.assign(E, REMOVED);
+    first.assign(N, NONE);
+    last.assign(N, NONE);
+    size.assign(N, 0);
+
+    // is position p of n's list in n's phase 1 window?
+    auto inWindow = [&](const std::size_t n, const std::size_t p) {
+        return proposal_to[n] != N && static_cast<std::size_t>(proposed_to[n]) <= p + 1 && p <= proposal_from[n];
+    };
+
+    for (std::size_t n = 0; n < N; n++) {
+        if (proposal_to[n] == N) {
+            continue;
+        }
+        for (std::size_t p = static_cast<std::size_t>(proposed_to[n]) - 1; p <= proposal_from[n]; p++) {
+            const std::size_t k = ptr(n) + p;
+            if (mirror[k] == NONE || !inWindow(idx(k), mirror[k])) {
+                continue;
+            }
+            prev[k] = last[n];
+            next[k] = NONE;
+            if (last[n] == NONE) { first[n] = p; } else { next[ptr(n) + last[n]] = p; }
+            last[n] = p;
+            size[n]++;
+        }
+
+        // n has to be matched, but nobody is left
+        if (size[n] == 0) {
+            return false;
+        }
+    }
+
+    // removes position p from n's table
+    auto remove = [&](const std::size_t n, const std::size_t p) {
+        const std::size_t k = ptr(n) + p;
+        if (prev[k] == NONE) { first[n] = next[k]; } else { next[ptr(n) + prev[k]] = next[k]; }
+        if (next[k] == NONE) { last[n] = prev[k]; } else { prev[ptr(n) + next[k]] = prev[k]; }
+        prev[k] = REMOVED;
+        size[n]--;
+    };
+
+    // Eliminate rotations
+    auto second = [&](const std::size_t p) { return idx(ptr(p) + next[ptr(p) + first[p]]); };
+    auto lastEntry = [&](const std::size_t m) { return idx(ptr(m) + last[m]); };
+    auto reduce = [&](const std::size_t m) {
+        // m needs to be removed from the table of the last entry in m's
+        // table and vice versa.
+        const std::size_t p = last[m];
+        const std::size_t k = ptr(m) + p;
+        const std::size_t o = idx(k);
+        if (prev[ptr(o) + mirror[k]] == REMOVED) { return false; }
+        remove(o, mirror[k]);
+
+        // Check to see if there's only one element remaining (if so, no stable matching.)
+        if (size[m] == 1) { return false; }
+
+        remove(m, p);
+        return true;
+    };
+    if (!eliminateRotations(size, second, lastEntry, reduce, scratch.x, scratch.index,
+                            scratch.in_index, scratch.active, statistics)) {
+        return false;
+    }
+
+    statistics.phase("phase 2");
+
+    // Check if anyone who has to be matched is left with an empty table
+    for (std::size_t n = 0; n < N; n++) {
+        if (proposal_to[n] != N && size[n] == 0) { return false; }
+    }
+
+    // Create the matchings
+    for (std::size_t n = 0; n < N; n++) {
+        matchings[n] = proposal_to[n] != N ? idx(ptr(n) + first[n]) : N;
+    }
+
+    return true;
+}
+
+}
+
+#endif
@@ -0,0 +1,113 @@
+//  matchingR -- Matching Algorithms in R and C++
+//
+//  Copyright (C) 2015  Jan Tilly <jtilly@econ.upenn.edu>
+//                      Nick Janetos <njanetos@econ.upenn.edu>
+//
+//  This file is part of matchingR.
+//
+//  matchingR is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation, either version 2 of the License, or
+//  (at your option) any later version.
+//
+//  matchingR is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+
+#ifndef matchingR_statistics_h
+#define matchingR_statistics_h
+
+#include <cstddef>
+
+#ifdef MATCHINGR_STATISTICS
+#include <algorithm>
+#include <chrono>
+#include <string>
+#include <utility>
+#include <vector>
+#endif
+
+namespace matchingR {
+
+// Counts the work that the algorithms do and times their phases. Statistics
+// are only recorded if MATCHINGR_STATISTICS is defined at compile time, e.g.
+// with CPPFLAGS += -DMATCHINGR_STATISTICS in ~/.R/Makevars. Otherwise all
+// member functions are empty and the calls in the algorithms compile to
+// nothing. The algorithms keep their statistics in their scratch buffers, so
+// the counts add up if a scratch is reused for several markets.
+struct Statistics {
+
+#ifdef MATCHINGR_STATISTICS
+
+    static constexpr bool enabled = true;
+
+    // proposals and rejections (deferred acceptance and phase 1 of Irving's
+    // algorithm), including proposers that are dumped for someone else
+    std::size_t proposals = 0, rejections = 0;
+
+    // the longest queue of proposers that still have to propose
+    std::size_t maxQueueLength = 0;
+
+    // failed compare-and-swap attempts of the parallel deferred acceptance,
+    // i.e. proposals that had to be retried because another thread changed
+    // the reviewer's partner first
+    std::size_t retries = 0;
+
+    // rotations that are eliminated in phase 2 of Irving's algorithm
+    std::size_t rotations = 0;
+
+    // lengths of the cycles of the top trading cycle algorithm
+    std::vector<std::size_t> cycleLengths;
+
+    // wall time of each phase in seconds, in the order of the phases
+    std::vector< std::pair<std::string, double> > phases;
+
+    void proposal() { proposals++; }
+    void rejection() { rejections++; }
+    void queueLength(const std::size_t length) { maxQueueLength = std::max(maxQueueLength, length); }
+    void retry() { retries++; }
+    void rotation() { rotations++; }
+    void cycle(const std::size_t length) { cycleLengths.push_back(length); }
+
+    // ends the current phase, which started when the previous phase ended or
+    // when the statistics were created
+    void phase(const char* name) {
+        const std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+        phases.push_back(std::make_pair(std::string(name), std::chrono::duration<double>(now - lap).count()));
+        lap = now;
+    }
+
+    // adds the counts of a thread that worked on the same market
+    void merge(const Statistics& other) {
+        proposals += other.proposals;
+        rejections += other.rejections;
+        maxQueueLength = std::max(maxQueueLength, other.maxQueueLength);
+        retries += other.retries;
+        rotations += other.rotations;
+        cycleLengths.insert(cycleLengths.end(), other.cycleLengths.begin(), other.cycleLengths.end());
+    }
+
+private:
+    std::chrono::steady_clock::time_point lap = std::chrono::steady_clock::now();
+
+#else
+
+    static constexpr bool enabled = false;
+
+    void proposal() {}
+    void rejection() {}
+    void queueLength(const std::size_t) {}
+    void retry() {}
+    void rotation() {}
+    void cycle(const std::size_t) {}
+    void phase(const char*) {}
+    void merge(const Statistics&) {}
+
+#endif
+
+};
+
+}
+
+#endif
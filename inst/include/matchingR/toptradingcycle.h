@@ -0,0 +1,129 @@
+//  matchingR -- Matching Algorithms in R and C++
+//
+//  Copyright (C) 2015  Jan Tilly <jtilly@econ.upenn.edu>
+//                      Nick Janetos <njanetos@econ.upenn.edu>
+//
+//  This file is part of matchingR.
+//
+//  matchingR is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation, either version 2 of the License, or
+//  (at your option) any later version.
+//
+//  matchingR is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+
+#ifndef matchingR_toptradingcycle_h
+#define matchingR_toptradingcycle_h
+
+#include <cstddef>
+#include <vector>
+
+#include "matrix.h"
+#include "statistics.h"
+
+namespace matchingR {
+
+// buffers used by ttcMatching, so that they can be reused across markets.
+// Index must be able to hold N.
+template <typename Index>
+struct TTCScratch {
+    std::vector<Index> is_matched, next, on_path;
+    std::vector<Index> path;
+    Statistics statistics;
+};
+
+// The top trading cycle algorithm. pref is N by N and its column j lists the
+// agents whose houses j likes best in order. matchings is a random access
+// iterator to N elements. Returns false if some participant runs out of
+// preferences before being matched.
+template <typename Pref, typename Iter, typename Index>
+bool ttcMatching(const Pref& pref, Iter matchings, TTCScratch<Index>& scratch) {
+
+    // the number of participants
+    const std::size_t N = pref.n_cols;
+
+    // a vector of zeros and ones, encodes whether a
+    // participant has been matched or not
+    // everyone begins unmatched.
+    std::vector<Index>& is_matched = scratch.is_matched;
+    is_matched.assign(N, 0);
+
+    // the number of participants that are still unmatched
+    std::size_t unmatched = N;
+
+    // the vector of matchings to be returned (N means not matched yet)
+    for (std::size_t n = 0; n < N; n++) {
+        matchings[n] = N;
+    }
+
+    // position of each participant's most preferred outcome that may still be
+    // unmatched. matched participants never become unmatched again, so these
+    // pointers only move forward.
+    std::vector<Index>& next = scratch.next;
+    next.assign(N, 0);
+
+    // the current chain of participants, each pointing to the next one
+    std::vector<Index>& path = scratch.path;
+    path.clear();
+    path.reserve(N);
+    std::vector<Index>& on_path = scratch.on_path;
+    on_path.assign(N, 0);
+
+    // participants before first_unmatched have all been matched
+    std::size_t first_unmatched = 0;
+
+    // loop until everyone's been matched
+    while (unmatched > 0) {
+
+        // start a new chain with the first unmatched guy
+        if (path.empty()) {
+            while (is_matched[first_unmatched]) {
+                first_unmatched++;
+            }
+            path.push_back(first_unmatched);
+            on_path[first_unmatched] = 1;
+        }
+
+        const std::size_t current_agent = path.back();
+
+        // find current_agent's most preferred, unmatched outcome, p
+        // provisionally match current_agent to p by setting matchings[current_agent] = p
+        while (next[current_agent] < pref.n_rows && is_matched[pref(next[current_agent], current_agent)]) {
+            next[current_agent]++;
+        }
+        if (next[current_agent] == pref.n_rows) {
+            return false;
+        }
+        const std::size_t p = pref(next[current_agent], current_agent);
+        matchings[current_agent] = p;
+
+        if (on_path[p]) {
+            // we have a rotation, starting with p and ending with
+            // current_agent. remove it from the chain and match everyone on
+            // it. the rest of the chain can be used to find the next rotation.
+            std::size_t agent;
+            const std::size_t length = path.size();
+            do {
+                agent = path.back();
+                path.pop_back();
+                on_path[agent] = 0;
+                is_matched[agent] = 1;
+                unmatched--;
+            } while (agent != p);
+            scratch.statistics.cycle(length - path.size());
+        } else {
+            // otherwise, continue looking for a rotation with p
+            path.push_back(p);
+            on_path[p] = 1;
+        }
+    }
+
+    return true;
+}
+
+}
+
+#endif
@@ -8,121 +8,503 @@
 using namespace Rcpp;
 
 // cpp_wrapper_galeshapley
-List cpp_wrapper_galeshapley(const umat& proposerPref, const mat& reviewerUtils);
+List cpp_wrapper_galeshapley(SEXP proposerPref, const mat& reviewerUtils);
 RcppExport SEXP _matchingR_cpp_wrapper_galeshapley(SEXP proposerPrefSEXP, SEXP reviewerUtilsSEXP) {
 BEGIN_RCPP
     Rcpp::RObject rcpp_result_gen;
     Rcpp::RNGScope rcpp_rngScope_gen;
-    Rcpp::traits::input_parameter< const umat& >::type proposerPref(proposerPrefSEXP);
+    Rcpp::traits::input_parameter< SEXP >::type proposerPref(proposerPrefSEXP);
     Rcpp::traits::input_parameter< const mat& >::type reviewerUtils(reviewerUtilsSEXP);
     rcpp_result_gen = Rcpp::wrap(cpp_wrapper_galeshapley(proposerPref, reviewerUtils));
     return rcpp_result_gen;
 END_RCPP
 }
+// cpp_wrapper_galeshapley_market
+List cpp_wrapper_galeshapley_market(SEXP proposerInput, SEXP reviewerInput, const bool proposerOrdinal, const bool reviewerOrdinal, const bool parallel);
+RcppExport SEXP _matchingR_cpp_wrapper_galeshapley_market(SEXP proposerInputSEXP, SEXP reviewerInputSEXP, SEXP proposerOrdinalSEXP, SEXP reviewerOrdinalSEXP, SEXP parallelSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< SEXP >::type proposerInput(proposerInputSEXP);
+    Rcpp::traits::input_parameter< SEXP >::type reviewerInput(reviewerInputSEXP);
+    Rcpp::traits::input_parameter< const bool >::type proposerOrdinal(proposerOrdinalSEXP);
+    Rcpp::traits::input_parameter< const bool >::type reviewerOrdinal(reviewerOrdinalSEXP);
+    Rcpp::traits::input_parameter< const bool >::type parallel(parallelSEXP);
+    rcpp_result_gen = Rcpp::wrap(cpp_wrapper_galeshapley_market(proposerInput, reviewerInput, proposerOrdinal, reviewerOrdinal, parallel));
+    return rcpp_result_gen;
+END_RCPP
+}
+// cpp_wrapper_galeshapley_batch
+List cpp_wrapper_galeshapley_batch(const cube& proposerUtils, const cube& reviewerUtils);
+RcppExport SEXP _matchingR_cpp_wrapper_galeshapley_batch(SEXP proposerUtilsSEXP, SEXP reviewerUtilsSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< const cube& >::type proposerUtils(proposerUtilsSEXP);
+    Rcpp::traits::input_parameter< const cube& >::type reviewerUtils(reviewerUtilsSEXP);
+    rcpp_result_gen = Rcpp::wrap(cpp_wrapper_galeshapley_batch(proposerUtils, reviewerUtils));
+    return rcpp_result_gen;
+END_RCPP
+}
+// cpp_wrapper_galeshapley_lottery
+umat cpp_wrapper_galeshapley_lottery(const mat& proposerInput, const mat& reviewerClasses, const bool proposerOrdinal, const bool singleTieBreaking, const uword draws, const double seed);
+RcppExport SEXP _matchingR_cpp_wrapper_galeshapley_lottery(SEXP proposerInputSEXP, SEXP reviewerClassesSEXP, SEXP proposerOrdinalSEXP, SEXP singleTieBreakingSEXP, SEXP drawsSEXP, SEXP seedSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< const mat& >::type proposerInput(proposerInputSEXP);
+    Rcpp::traits::input_parameter< const mat& >::type reviewerClasses(reviewerClassesSEXP);
+    Rcpp::traits::input_parameter< const bool >::type proposerOrdinal(proposerOrdinalSEXP);
+    Rcpp::traits::input_parameter< const bool >::type singleTieBreaking(singleTieBreakingSEXP);
+    Rcpp::traits::input_parameter< const uword >::type draws(drawsSEXP);
+    Rcpp::traits::input_parameter< const double >::type seed(seedSEXP);
+    rcpp_result_gen = Rcpp::wrap(cpp_wrapper_galeshapley_lottery(proposerInput, reviewerClasses, proposerOrdinal, singleTieBreaking, draws, seed));
+    return rcpp_result_gen;
+END_RCPP
+}
+// cpp_wrapper_galeshapley_ordinal
+List cpp_wrapper_galeshapley_ordinal(SEXP proposerPref, SEXP reviewerRanks);
+RcppExport SEXP _matchingR_cpp_wrapper_galeshapley_ordinal(SEXP proposerPrefSEXP, SEXP reviewerRanksSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< SEXP >::type proposerPref(proposerPrefSEXP);
+    Rcpp::traits::input_parameter< SEXP >::type reviewerRanks(reviewerRanksSEXP);
+    rcpp_result_gen = Rcpp::wrap(cpp_wrapper_galeshapley_ordinal(proposerPref, reviewerRanks));
+    return rcpp_result_gen;
+END_RCPP
+}
+// cpp_wrapper_galeshapley_college_result
+List cpp_wrapper_galeshapley_college_result(const umat& matchedColleges, const umat& matchedStudents, const uvec& slots, const uword nProposals);
+RcppExport SEXP _matchingR_cpp_wrapper_galeshapley_college_result(SEXP matchedCollegesSEXP, SEXP matchedStudentsSEXP, SEXP slotsSEXP, SEXP nProposalsSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< const umat& >::type matchedColleges(matchedCollegesSEXP);
+    Rcpp::traits::input_parameter< const umat& >::type matchedStudents(matchedStudentsSEXP);
+    Rcpp::traits::input_parameter< const uvec& >::type slots(slotsSEXP);
+    Rcpp::traits::input_parameter< const uword >::type nProposals(nProposalsSEXP);
+    rcpp_result_gen = Rcpp::wrap(cpp_wrapper_galeshapley_college_result(matchedColleges, matchedStudents, slots, nProposals));
+    return rcpp_result_gen;
+END_RCPP
+}
+// cpp_wrapper_galeshapley_college
+List cpp_wrapper_galeshapley_college(SEXP proposerPref, const mat& reviewerUtils, const uvec& slots, const bool studentOptimal);
+RcppExport SEXP _matchingR_cpp_wrapper_galeshapley_college(SEXP proposerPrefSEXP, SEXP reviewerUtilsSEXP, SEXP slotsSEXP, SEXP studentOptimalSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< SEXP >::type proposerPref(proposerPrefSEXP);
+    Rcpp::traits::input_parameter< const mat& >::type reviewerUtils(reviewerUtilsSEXP);
+    Rcpp::traits::input_parameter< const uvec& >::type slots(slotsSEXP);
+    Rcpp::traits::input_parameter< const bool >::type studentOptimal(studentOptimalSEXP);
+    rcpp_result_gen = Rcpp::wrap(cpp_wrapper_galeshapley_college(proposerPref, reviewerUtils, slots, studentOptimal));
+    return rcpp_result_gen;
+END_RCPP
+}
+// cpp_wrapper_galeshapley_sparse
+List cpp_wrapper_galeshapley_sparse(const uvec& proposerPtr, const uvec& proposerIdx, const uvec& reviewerPtr, const uvec& reviewerIdx, const uvec& proposerSlots, const uvec& reviewerSlots);
+RcppExport SEXP _matchingR_cpp_wrapper_galeshapley_sparse(SEXP proposerPtrSEXP, SEXP proposerIdxSEXP, SEXP reviewerPtrSEXP, SEXP reviewerIdxSEXP, SEXP proposerSlotsSEXP, SEXP reviewerSlotsSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< const uvec& >::type proposerPtr(proposerPtrSEXP);
+    Rcpp::traits::input_parameter< const uvec& >::type proposerIdx(proposerIdxSEXP);
+    Rcpp::traits::input_parameter< const uvec& >::type reviewerPtr(reviewerPtrSEXP);
+    Rcpp::traits::input_parameter< const uvec& >::type reviewerIdx(reviewerIdxSEXP);
+    Rcpp::traits::input_parameter< const uvec& >::type proposerSlots(proposerSlotsSEXP);
+    Rcpp::traits::input_parameter< const uvec& >::type reviewerSlots(reviewerSlotsSEXP);
+    rcpp_result_gen = Rcpp::wrap(cpp_wrapper_galeshapley_sparse(proposerPtr, proposerIdx, reviewerPtr, reviewerIdx, proposerSlots, reviewerSlots));
+    return rcpp_result_gen;
+END_RCPP
+}
+// cpp_wrapper_galeshapley_rematch
+List cpp_wrapper_galeshapley_rematch(const uvec& proposerPtr, const uvec& proposerIdx, const uvec& reviewerPtr, const uvec& reviewerIdx, const uvec& proposals, const uvec& changedProposers, const uvec& changedReviewers);
+RcppExport SEXP _matchingR_cpp_wrapper_galeshapley_rematch(SEXP proposerPtrSEXP, SEXP proposerIdxSEXP, SEXP reviewerPtrSEXP, SEXP reviewerIdxSEXP, SEXP proposalsSEXP, SEXP changedProposersSEXP, SEXP changedReviewersSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< const uvec& >::type proposerPtr(proposerPtrSEXP);
+    Rcpp::traits::input_parameter< const uvec& >::type proposerIdx(proposerIdxSEXP);
+    Rcpp::traits::input_parameter< const uvec& >::type reviewerPtr(reviewerPtrSEXP);
+    Rcpp::traits::input_parameter< const uvec& >::type reviewerIdx(reviewerIdxSEXP);
+    Rcpp::traits::input_parameter< const uvec& >::type proposals(proposalsSEXP);
+    Rcpp::traits::input_parameter< const uvec& >::type changedProposers(changedProposersSEXP);
+    Rcpp::traits::input_parameter< const uvec& >::type changedReviewers(changedReviewersSEXP);
+    rcpp_result_gen = Rcpp::wrap(cpp_wrapper_galeshapley_rematch(proposerPtr, proposerIdx, reviewerPtr, reviewerIdx, proposals, changedProposers, changedReviewers));
+    return rcpp_result_gen;
+END_RCPP
+}
+// cpp_wrapper_galeshapley_file
+List cpp_wrapper_galeshapley_file(const std::string& proposerFile, const std::string& reviewerFile);
+RcppExport SEXP _matchingR_cpp_wrapper_galeshapley_file(SEXP proposerFileSEXP, SEXP reviewerFileSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< const std::string& >::type proposerFile(proposerFileSEXP);
+    Rcpp::traits::input_parameter< const std::string& >::type reviewerFile(reviewerFileSEXP);
+    rcpp_result_gen = Rcpp::wrap(cpp_wrapper_galeshapley_file(proposerFile, reviewerFile));
+    return rcpp_result_gen;
+END_RCPP
+}
 // cpp_wrapper_galeshapley_check_stability
-bool cpp_wrapper_galeshapley_check_stability(mat proposerUtils, mat reviewerUtils, umat proposals, umat engagements);
+bool cpp_wrapper_galeshapley_check_stability(const mat& proposerUtils, const mat& reviewerUtils, const umat& proposals, const umat& engagements);
 RcppExport SEXP _matchingR_cpp_wrapper_galeshapley_check_stability(SEXP proposerUtilsSEXP, SEXP reviewerUtilsSEXP, SEXP proposalsSEXP, SEXP engagementsSEXP) {
 BEGIN_RCPP
     Rcpp::RObject rcpp_result_gen;
     Rcpp::RNGScope rcpp_rngScope_gen;
-    Rcpp::traits::input_parameter< mat >::type proposerUtils(proposerUtilsSEXP);
-    Rcpp::traits::input_parameter< mat >::type reviewerUtils(reviewerUtilsSEXP);
-    Rcpp::traits::input_parameter< umat >::type proposals(proposalsSEXP);
-    Rcpp::traits::input_parameter< umat >::type engagements(engagementsSEXP);
+    Rcpp::traits::input_parameter< const mat& >::type proposerUtils(proposerUtilsSEXP);
+    Rcpp::traits::input_parameter< const mat& >::type reviewerUtils(reviewerUtilsSEXP);
+    Rcpp::traits::input_parameter< const umat& >::type proposals(proposalsSEXP);
+    Rcpp::traits::input_parameter< const umat& >::type engagements(engagementsSEXP);
     rcpp_result_gen = Rcpp::wrap(cpp_wrapper_galeshapley_check_stability(proposerUtils, reviewerUtils, proposals, engagements));
     return rcpp_result_gen;
 END_RCPP
 }
+// cpp_wrapper_galeshapley_check_stability_ordinal
+bool cpp_wrapper_galeshapley_check_stability_ordinal(SEXP proposerRanks, SEXP reviewerRanks, const umat& proposals, const umat& engagements);
+RcppExport SEXP _matchingR_cpp_wrapper_galeshapley_check_stability_ordinal(SEXP proposerRanksSEXP, SEXP reviewerRanksSEXP, SEXP proposalsSEXP, SEXP engagementsSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< SEXP >::type proposerRanks(proposerRanksSEXP);
+    Rcpp::traits::input_parameter< SEXP >::type reviewerRanks(reviewerRanksSEXP);
+    Rcpp::traits::input_parameter< const umat& >::type proposals(proposalsSEXP);
+    Rcpp::traits::input_parameter< const umat& >::type engagements(engagementsSEXP);
+    rcpp_result_gen = Rcpp::wrap(cpp_wrapper_galeshapley_check_stability_ordinal(proposerRanks, reviewerRanks, proposals, engagements));
+    return rcpp_result_gen;
+END_RCPP
+}
+// cpp_wrapper_galeshapley_blocking_pairs
+List cpp_wrapper_galeshapley_blocking_pairs(SEXP proposerScores, SEXP reviewerScores, const umat& proposals, const umat& engagements, const bool countOnly, const bool utilities);
+RcppExport SEXP _matchingR_cpp_wrapper_galeshapley_blocking_pairs(SEXP proposerScoresSEXP, SEXP reviewerScoresSEXP, SEXP proposalsSEXP, SEXP engagementsSEXP, SEXP countOnlySEXP, SEXP utilitiesSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< SEXP >::type proposerScores(proposerScoresSEXP);
+    Rcpp::traits::input_parameter< SEXP >::type reviewerScores(reviewerScoresSEXP);
+    Rcpp::traits::input_parameter< const umat& >::type proposals(proposalsSEXP);
+    Rcpp::traits::input_parameter< const umat& >::type engagements(engagementsSEXP);
+    Rcpp::traits::input_parameter< const bool >::type countOnly(countOnlySEXP);
+    Rcpp::traits::input_parameter< const bool >::type utilities(utilitiesSEXP);
+    rcpp_result_gen = Rcpp::wrap(cpp_wrapper_galeshapley_blocking_pairs(proposerScores, reviewerScores, proposals, engagements, countOnly, utilities));
+    return rcpp_result_gen;
+END_RCPP
+}
+// cpp_wrapper_galeshapley_extremal
+List cpp_wrapper_galeshapley_extremal(SEXP proposerInput, SEXP reviewerInput, const bool proposerOrdinal, const bool reviewerOrdinal);
+RcppExport SEXP _matchingR_cpp_wrapper_galeshapley_extremal(SEXP proposerInputSEXP, SEXP reviewerInputSEXP, SEXP proposerOrdinalSEXP, SEXP reviewerOrdinalSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< SEXP >::type proposerInput(proposerInputSEXP);
+    Rcpp::traits::input_parameter< SEXP >::type reviewerInput(reviewerInputSEXP);
+    Rcpp::traits::input_parameter< const bool >::type proposerOrdinal(proposerOrdinalSEXP);
+    Rcpp::traits::input_parameter< const bool >::type reviewerOrdinal(reviewerOrdinalSEXP);
+    rcpp_result_gen = Rcpp::wrap(cpp_wrapper_galeshapley_extremal(proposerInput, reviewerInput, proposerOrdinal, reviewerOrdinal));
+    return rcpp_result_gen;
+END_RCPP
+}
+// cpp_wrapper_galeshapley_rotations
+List cpp_wrapper_galeshapley_rotations(SEXP proposerInput, SEXP reviewerInput, const bool proposerOrdinal, const bool reviewerOrdinal);
+RcppExport SEXP _matchingR_cpp_wrapper_galeshapley_rotations(SEXP proposerInputSEXP, SEXP reviewerInputSEXP, SEXP proposerOrdinalSEXP, SEXP reviewerOrdinalSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< SEXP >::type proposerInput(proposerInputSEXP);
+    Rcpp::traits::input_parameter< SEXP >::type reviewerInput(reviewerInputSEXP);
+    Rcpp::traits::input_parameter< const bool >::type proposerOrdinal(proposerOrdinalSEXP);
+    Rcpp::traits::input_parameter< const bool >::type reviewerOrdinal(reviewerOrdinalSEXP);
+    rcpp_result_gen = Rcpp::wrap(cpp_wrapper_galeshapley_rotations(proposerInput, reviewerInput, proposerOrdinal, reviewerOrdinal));
+    return rcpp_result_gen;
+END_RCPP
+}
+// cpp_wrapper_galeshapley_optimal
+List cpp_wrapper_galeshapley_optimal(SEXP proposerInput, SEXP reviewerInput, const bool proposerOrdinal, const bool reviewerOrdinal, const bool egalitarian);
+RcppExport SEXP _matchingR_cpp_wrapper_galeshapley_optimal(SEXP proposerInputSEXP, SEXP reviewerInputSEXP, SEXP proposerOrdinalSEXP, SEXP reviewerOrdinalSEXP, SEXP egalitarianSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< SEXP >::type proposerInput(proposerInputSEXP);
+    Rcpp::traits::input_parameter< SEXP >::type reviewerInput(reviewerInputSEXP);
+    Rcpp::traits::input_parameter< const bool >::type proposerOrdinal(proposerOrdinalSEXP);
+    Rcpp::traits::input_parameter< const bool >::type reviewerOrdinal(reviewerOrdinalSEXP);
+    Rcpp::traits::input_parameter< const bool >::type egalitarian(egalitarianSEXP);
+    rcpp_result_gen = Rcpp::wrap(cpp_wrapper_galeshapley_optimal(proposerInput, reviewerInput, proposerOrdinal, reviewerOrdinal, egalitarian));
+    return rcpp_result_gen;
+END_RCPP
+}
+// cpp_wrapper_galeshapley_enumerator
+SEXP cpp_wrapper_galeshapley_enumerator(SEXP proposerInput, SEXP reviewerInput, const bool proposerOrdinal, const bool reviewerOrdinal);
+RcppExport SEXP _matchingR_cpp_wrapper_galeshapley_enumerator(SEXP proposerInputSEXP, SEXP reviewerInputSEXP, SEXP proposerOrdinalSEXP, SEXP reviewerOrdinalSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< SEXP >::type proposerInput(proposerInputSEXP);
+    Rcpp::traits::input_parameter< SEXP >::type reviewerInput(reviewerInputSEXP);
+    Rcpp::traits::input_parameter< const bool >::type proposerOrdinal(proposerOrdinalSEXP);
+    Rcpp::traits::input_parameter< const bool >::type reviewerOrdinal(reviewerOrdinalSEXP);
+    rcpp_result_gen = Rcpp::wrap(cpp_wrapper_galeshapley_enumerator(proposerInput, reviewerInput, proposerOrdinal, reviewerOrdinal));
+    return rcpp_result_gen;
+END_RCPP
+}
+// cpp_wrapper_galeshapley_enumerator_next
+SEXP cpp_wrapper_galeshapley_enumerator_next(SEXP enumerator);
+RcppExport SEXP _matchingR_cpp_wrapper_galeshapley_enumerator_next(SEXP enumeratorSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< SEXP >::type enumerator(enumeratorSEXP);
+    rcpp_result_gen = Rcpp::wrap(cpp_wrapper_galeshapley_enumerator_next(enumerator));
+    return rcpp_result_gen;
+END_RCPP
+}
 // cpp_wrapper_irving
-uvec cpp_wrapper_irving(const umat pref);
+SEXP cpp_wrapper_irving(SEXP pref);
 RcppExport SEXP _matchingR_cpp_wrapper_irving(SEXP prefSEXP) {
 BEGIN_RCPP
     Rcpp::RObject rcpp_result_gen;
     Rcpp::RNGScope rcpp_rngScope_gen;
-    Rcpp::traits::input_parameter< const umat >::type pref(prefSEXP);
+    Rcpp::traits::input_parameter< SEXP >::type pref(prefSEXP);
     rcpp_result_gen = Rcpp::wrap(cpp_wrapper_irving(pref));
     return rcpp_result_gen;
 END_RCPP
 }
+// cpp_wrapper_irving_sparse
+SEXP cpp_wrapper_irving_sparse(const uvec& ptr, const uvec& idx);
+RcppExport SEXP _matchingR_cpp_wrapper_irving_sparse(SEXP ptrSEXP, SEXP idxSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< const uvec& >::type ptr(ptrSEXP);
+    Rcpp::traits::input_parameter< const uvec& >::type idx(idxSEXP);
+    rcpp_result_gen = Rcpp::wrap(cpp_wrapper_irving_sparse(ptr, idx));
+    return rcpp_result_gen;
+END_RCPP
+}
+// cpp_wrapper_irving_file
+SEXP cpp_wrapper_irving_file(const std::string& file);
+RcppExport SEXP _matchingR_cpp_wrapper_irving_file(SEXP fileSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< const std::string& >::type file(fileSEXP);
+    rcpp_result_gen = Rcpp::wrap(cpp_wrapper_irving_file(file));
+    return rcpp_result_gen;
+END_RCPP
+}
+// cpp_wrapper_irving_batch
+List cpp_wrapper_irving_batch(const cube& utils);
+RcppExport SEXP _matchingR_cpp_wrapper_irving_batch(SEXP utilsSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< const cube& >::type utils(utilsSEXP);
+    rcpp_result_gen = Rcpp::wrap(cpp_wrapper_irving_batch(utils));
+    return rcpp_result_gen;
+END_RCPP
+}
 // cpp_wrapper_irving_check_stability
-bool cpp_wrapper_irving_check_stability(umat& pref, umat& matchings);
+bool cpp_wrapper_irving_check_stability(SEXP pref, const umat& matchings);
 RcppExport SEXP _matchingR_cpp_wrapper_irving_check_stability(SEXP prefSEXP, SEXP matchingsSEXP) {
 BEGIN_RCPP
     Rcpp::RObject rcpp_result_gen;
     Rcpp::RNGScope rcpp_rngScope_gen;
-    Rcpp::traits::input_parameter< umat& >::type pref(prefSEXP);
-    Rcpp::traits::input_parameter< umat& >::type matchings(matchingsSEXP);
+    Rcpp::traits::input_parameter< SEXP >::type pref(prefSEXP);
+    Rcpp::traits::input_parameter< const umat& >::type matchings(matchingsSEXP);
     rcpp_result_gen = Rcpp::wrap(cpp_wrapper_irving_check_stability(pref, matchings));
     return rcpp_result_gen;
 END_RCPP
 }
+// cpp_wrapper_irving_blocking_pairs
+List cpp_wrapper_irving_blocking_pairs(SEXP pref, const umat& matchings);
+RcppExport SEXP _matchingR_cpp_wrapper_irving_blocking_pairs(SEXP prefSEXP, SEXP matchingsSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< SEXP >::type pref(prefSEXP);
+    Rcpp::traits::input_parameter< const umat& >::type matchings(matchingsSEXP);
+    rcpp_result_gen = Rcpp::wrap(cpp_wrapper_irving_blocking_pairs(pref, matchings));
+    return rcpp_result_gen;
+END_RCPP
+}
 // cpp_wrapper_ttc
-uvec cpp_wrapper_ttc(const umat pref);
+SEXP cpp_wrapper_ttc(SEXP pref);
 RcppExport SEXP _matchingR_cpp_wrapper_ttc(SEXP prefSEXP) {
 BEGIN_RCPP
     Rcpp::RObject rcpp_result_gen;
     Rcpp::RNGScope rcpp_rngScope_gen;
-    Rcpp::traits::input_parameter< const umat >::type pref(prefSEXP);
+    Rcpp::traits::input_parameter< SEXP >::type pref(prefSEXP);
     rcpp_result_gen = Rcpp::wrap(cpp_wrapper_ttc(pref));
     return rcpp_result_gen;
 END_RCPP
 }
+// cpp_wrapper_ttc_file
+uvec cpp_wrapper_ttc_file(const std::string& file);
+RcppExport SEXP _matchingR_cpp_wrapper_ttc_file(SEXP fileSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< const std::string& >::type file(fileSEXP);
+    rcpp_result_gen = Rcpp::wrap(cpp_wrapper_ttc_file(file));
+    return rcpp_result_gen;
+END_RCPP
+}
+// cpp_wrapper_ttc_batch
+umat cpp_wrapper_ttc_batch(const cube& utils);
+RcppExport SEXP _matchingR_cpp_wrapper_ttc_batch(SEXP utilsSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< const cube& >::type utils(utilsSEXP);
+    rcpp_result_gen = Rcpp::wrap(cpp_wrapper_ttc_batch(utils));
+    return rcpp_result_gen;
+END_RCPP
+}
 // cpp_wrapper_ttc_check_stability
-bool cpp_wrapper_ttc_check_stability(umat pref, uvec matchings);
+bool cpp_wrapper_ttc_check_stability(SEXP pref, const uvec& matchings);
 RcppExport SEXP _matchingR_cpp_wrapper_ttc_check_stability(SEXP prefSEXP, SEXP matchingsSEXP) {
 BEGIN_RCPP
     Rcpp::RObject rcpp_result_gen;
     Rcpp::RNGScope rcpp_rngScope_gen;
-    Rcpp::traits::input_parameter< umat >::type pref(prefSEXP);
-    Rcpp::traits::input_parameter< uvec >::type matchings(matchingsSEXP);
+    Rcpp::traits::input_parameter< SEXP >::type pref(prefSEXP);
+    Rcpp::traits::input_parameter< const uvec& >::type matchings(matchingsSEXP);
     rcpp_result_gen = Rcpp::wrap(cpp_wrapper_ttc_check_stability(pref, matchings));
     return rcpp_result_gen;
 END_RCPP
 }
+// cpp_wrapper_ttc_blocking_coalition
+uvec cpp_wrapper_ttc_blocking_coalition(SEXP pref, const uvec& matchings);
+RcppExport SEXP _matchingR_cpp_wrapper_ttc_blocking_coalition(SEXP prefSEXP, SEXP matchingsSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< SEXP >::type pref(prefSEXP);
+    Rcpp::traits::input_parameter< const uvec& >::type matchings(matchingsSEXP);
+    rcpp_result_gen = Rcpp::wrap(cpp_wrapper_ttc_blocking_coalition(pref, matchings));
+    return rcpp_result_gen;
+END_RCPP
+}
 // sortIndex
-umat sortIndex(const mat& u);
-RcppExport SEXP _matchingR_sortIndex(SEXP uSEXP) {
+umat sortIndex(const mat& u, const int k);
+RcppExport SEXP _matchingR_sortIndex(SEXP uSEXP, SEXP kSEXP) {
 BEGIN_RCPP
     Rcpp::RObject rcpp_result_gen;
     Rcpp::RNGScope rcpp_rngScope_gen;
     Rcpp::traits::input_parameter< const mat& >::type u(uSEXP);
-    rcpp_result_gen = Rcpp::wrap(sortIndex(u));
+    Rcpp::traits::input_parameter< const int >::type k(kSEXP);
+    rcpp_result_gen = Rcpp::wrap(sortIndex(u, k));
     return rcpp_result_gen;
 END_RCPP
 }
 // sortIndexOneSided
-umat sortIndexOneSided(const mat& u);
-RcppExport SEXP _matchingR_sortIndexOneSided(SEXP uSEXP) {
+umat sortIndexOneSided(const mat& u, const int k);
+RcppExport SEXP _matchingR_sortIndexOneSided(SEXP uSEXP, SEXP kSEXP) {
 BEGIN_RCPP
     Rcpp::RObject rcpp_result_gen;
     Rcpp::RNGScope rcpp_rngScope_gen;
     Rcpp::traits::input_parameter< const mat& >::type u(uSEXP);
-    rcpp_result_gen = Rcpp::wrap(sortIndexOneSided(u));
+    Rcpp::traits::input_parameter< const int >::type k(kSEXP);
+    rcpp_result_gen = Rcpp::wrap(sortIndexOneSided(u, k));
+    return rcpp_result_gen;
+END_RCPP
+}
+// readPreferenceOrder
+List readPreferenceOrder(const mat& pref);
+RcppExport SEXP _matchingR_readPreferenceOrder(SEXP prefSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< const mat& >::type pref(prefSEXP);
+    rcpp_result_gen = Rcpp::wrap(readPreferenceOrder(pref));
     return rcpp_result_gen;
 END_RCPP
 }
 // rankIndex
-umat rankIndex(const umat& sortedIdx);
+umat rankIndex(SEXP sortedIdx);
 RcppExport SEXP _matchingR_rankIndex(SEXP sortedIdxSEXP) {
 BEGIN_RCPP
     Rcpp::RObject rcpp_result_gen;
     Rcpp::RNGScope rcpp_rngScope_gen;
-    Rcpp::traits::input_parameter< const umat& >::type sortedIdx(sortedIdxSEXP);
+    Rcpp::traits::input_parameter< SEXP >::type sortedIdx(sortedIdxSEXP);
     rcpp_result_gen = Rcpp::wrap(rankIndex(sortedIdx));
     return rcpp_result_gen;
 END_RCPP
 }
+// cpp_write_preference_file
+void cpp_write_preference_file(SEXP pref, const std::string& file, const bool ranks);
+RcppExport SEXP _matchingR_cpp_write_preference_file(SEXP prefSEXP, SEXP fileSEXP, SEXP ranksSEXP) {
+BEGIN_RCPP
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< SEXP >::type pref(prefSEXP);
+    Rcpp::traits::input_parameter< const std::string& >::type file(fileSEXP);
+    Rcpp::traits::input_parameter< const bool >::type ranks(ranksSEXP);
+    cpp_write_preference_file(pref, file, ranks);
+    return R_NilValue;
+END_RCPP
+}
+// cpp_write_preference_file_sparse
+void cpp_write_preference_file_sparse(const uvec& ptr, const uvec& idx, const uword n, const std::string& file);
+RcppExport SEXP _matchingR_cpp_write_preference_file_sparse(SEXP ptrSEXP, SEXP idxSEXP, SEXP nSEXP, SEXP fileSEXP) {
+BEGIN_RCPP
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< const uvec& >::type ptr(ptrSEXP);
+    Rcpp::traits::input_parameter< const uvec& >::type idx(idxSEXP);
+    Rcpp::traits::input_parameter< const uword >::type n(nSEXP);
+    Rcpp::traits::input_parameter< const std::string& >::type file(fileSEXP);
+    cpp_write_preference_file_sparse(ptr, idx, n, file);
+    return R_NilValue;
+END_RCPP
+}
+// cpp_preference_file_info
+List cpp_preference_file_info(const std::string& file);
+RcppExport SEXP _matchingR_cpp_preference_file_info(SEXP fileSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< const std::string& >::type file(fileSEXP);
+    rcpp_result_gen = Rcpp::wrap(cpp_preference_file_info(file));
+    return rcpp_result_gen;
+END_RCPP
+}
 
 static const R_CallMethodDef CallEntries[] = {
     {"_matchingR_cpp_wrapper_galeshapley", (DL_FUNC) &_matchingR_cpp_wrapper_galeshapley, 2},
+    {"_matchingR_cpp_wrapper_galeshapley_market", (DL_FUNC) &_matchingR_cpp_wrapper_galeshapley_market, 5},
+    {"_matchingR_cpp_wrapper_galeshapley_batch", (DL_FUNC) &_matchingR_cpp_wrapper_galeshapley_batch, 2},
+    {"_matchingR_cpp_wrapper_galeshapley_lottery", (DL_FUNC) &_matchingR_cpp_wrapper_galeshapley_lottery, 6},
+    {"_matchingR_cpp_wrapper_galeshapley_ordinal", (DL_FUNC) &_matchingR_cpp_wrapper_galeshapley_ordinal, 2},
+    {"_matchingR_cpp_wrapper_galeshapley_college_result", (DL_FUNC) &_matchingR_cpp_wrapper_galeshapley_college_result, 4},
+    {"_matchingR_cpp_wrapper_galeshapley_college", (DL_FUNC) &_matchingR_cpp_wrapper_galeshapley_college, 4},
+    {"_matchingR_cpp_wrapper_galeshapley_sparse", (DL_FUNC) &_matchingR_cpp_wrapper_galeshapley_sparse, 6},
+    {"_matchingR_cpp_wrapper_galeshapley_rematch", (DL_FUNC) &_matchingR_cpp_wrapper_galeshapley_rematch, 7},
+    {"_matchingR_cpp_wrapper_galeshapley_file", (DL_FUNC) &_matchingR_cpp_wrapper_galeshapley_file, 2},
     {"_matchingR_cpp_wrapper_galeshapley_check_stability", (DL_FUNC) &_matchingR_cpp_wrapper_galeshapley_check_stability, 4},
+    {"_matchingR_cpp_wrapper_galeshapley_check_stability_ordinal", (DL_FUNC) &_matchingR_cpp_wrapper_galeshapley_check_stability_ordinal, 4},
+    {"_matchingR_cpp_wrapper_galeshapley_blocking_pairs", (DL_FUNC) &_matchingR_cpp_wrapper_galeshapley_blocking_pairs, 6},
+    {"_matchingR_cpp_wrapper_galeshapley_extremal", (DL_FUNC) &_matchingR_cpp_wrapper_galeshapley_extremal, 4},
+    {"_matchingR_cpp_wrapper_galeshapley_rotations", (DL_FUNC) &_matchingR_cpp_wrapper_galeshapley_rotations, 4},
+    {"_matchingR_cpp_wrapper_galeshapley_optimal", (DL_FUNC) &_matchingR_cpp_wrapper_galeshapley_optimal, 5},
+    {"_matchingR_cpp_wrapper_galeshapley_enumerator", (DL_FUNC) &_matchingR_cpp_wrapper_galeshapley_enumerator, 4},
+    {"_matchingR_cpp_wrapper_galeshapley_enumerator_next", (DL_FUNC) &_matchingR_cpp_wrapper_galeshapley_enumerator_next, 1},
     {"_matchingR_cpp_wrapper_irving", (DL_FUNC) &_matchingR_cpp_wrapper_irving, 1},
+    {"_matchingR_cpp_wrapper_irving_sparse", (DL_FUNC) &_matchingR_cpp_wrapper_irving_sparse, 2},
+    {"_matchingR_cpp_wrapper_irving_file", (DL_FUNC) &_matchingR_cpp_wrapper_irving_file, 1},
+    {"_matchingR_cpp_wrapper_irving_batch", (DL_FUNC) &_matchingR_cpp_wrapper_irving_batch, 1},
     {"_matchingR_cpp_wrapper_irving_check_stability", (DL_FUNC) &_matchingR_cpp_wrapper_irving_check_stability, 2},
+    {"_matchingR_cpp_wrapper_irving_blocking_pairs", (DL_FUNC) &_matchingR_cpp_wrapper_irving_blocking_pairs, 2},
     {"_matchingR_cpp_wrapper_ttc", (DL_FUNC) &_matchingR_cpp_wrapper_ttc, 1},
+    {"_matchingR_cpp_wrapper_ttc_file", (DL_FUNC) &_matchingR_cpp_wrapper_ttc_file, 1},
+    {"_matchingR_cpp_wrapper_ttc_batch", (DL_FUNC) &_matchingR_cpp_wrapper_ttc_batch, 1},
     {"_matchingR_cpp_wrapper_ttc_check_stability", (DL_FUNC) &_matchingR_cpp_wrapper_ttc_check_stability, 2},
-    {"_matchingR_sortIndex", (DL_FUNC) &_matchingR_sortIndex, 1},
-    {"_matchingR_sortIndexOneSided", (DL_FUNC) &_matchingR_sortIndexOneSided, 1},
+    {"_matchingR_cpp_wrapper_ttc_blocking_coalition", (DL_FUNC) &_matchingR_cpp_wrapper_ttc_blocking_coalition, 2},
+    {"_matchingR_sortIndex", (DL_FUNC) &_matchingR_sortIndex, 2},
+    {"_matchingR_sortIndexOneSided", (DL_FUNC) &_matchingR_sortIndexOneSided, 2},
+    {"_matchingR_readPreferenceOrder", (DL_FUNC) &_matchingR_readPreferenceOrder, 1},
     {"_matchingR_rankIndex", (DL_FUNC) &_matchingR_rankIndex, 1},
+    {"_matchingR_cpp_write_preference_file", (DL_FUNC) &_matchingR_cpp_write_preference_file, 3},
+    {"_matchingR_cpp_write_preference_file_sparse", (DL_FUNC) &_matchingR_cpp_write_preference_file_sparse, 4},
+    {"_matchingR_cpp_preference_file_info", (DL_FUNC) &_matchingR_cpp_preference_file_info, 1},
     {NULL, NULL, 0}
 };
 
@@ -16,6 +16,9 @@
 //  GNU General Public License for more details.
 
 #include <queue>
+#include <functional>
+#include <limits>
+#include <type_traits>
 #include <matchingR.h>
 
 #include "utils.h"
@@ -23,6 +26,26 @@
 
 // [[Rcpp::depends(RcppArmadillo)]]
 
+// Computes the Gale-Shapley algorithm for the preference orders of the
+// proposers and the cardinal utilities of the reviewers (see
+// cpp_wrapper_galeshapley). Pref can be a umat or a MatrixView, and Utils a
+// mat or a Mat<int>. The time since the statistics of scratch were created
+// counts as preprocessing.
+template <typename Pref, typename Utils>
+List galeShapleyCardinal(const Pref& proposerPref, const Utils& reviewerUtils, matchingR::GaleShapleyScratch& scratch) {
+
+    uvec proposals(proposerPref.n_cols), engagements(proposerPref.n_rows);
+
+    scratch.statistics.phase("preprocessing");
+    const uword nProposals = matchingR::galeShapleyMatching(proposerPref, reviewerUtils, proposals.begin(), engagements.begin(), scratch);
+    scratch.statistics.phase("matching");
+
+    return addStatistics(List::create(
+      _["proposals"]   = proposals,
+      _["engagements"] = engagements,
+      _["number.of.proposals"] = nProposals), scratch.statistics);
+}
+
 //' C++ wrapper for Gale-Shapley Algorithm
 //'
 //' This function provides an R wrapper for the C++ backend. Users should not
@@ -53,90 +76,1163 @@
 //'    element contains the number of the proposer that reviewer \code{j} is
 //'    matched to using C++ indexing. Reviewers that remain unmatched will be
 //'    listed as being matched to \code{n}.}
+//'    \item{\code{number.of.proposals} is the total number of proposals that
+//'    were made. Every proposer proposes to every reviewer at most once.}
+//'    \item{\code{statistics} is only included if the package was compiled
+//'    with \code{MATCHINGR_STATISTICS} defined. It is a list with the numbers
+//'    of proposals and rejections, the longest queue of proposers who still
+//'    have to propose, the number of compare-and-swap attempts that the
+//'    parallel algorithm had to retry, and the wall time of the preprocessing
+//'    and matching phases in seconds.}
 //'  }
 //' @export
 // [[Rcpp::export]]
-List cpp_wrapper_galeshapley(const umat& proposerPref, const mat& reviewerUtils) {
+List cpp_wrapper_galeshapley(SEXP proposerPref, const mat& reviewerUtils) {
+    matchingR::GaleShapleyScratch scratch;
+    return withMatrixView(proposerPref, [&](const auto& pref) {
+        return galeShapleyCardinal(pref, reviewerUtils, scratch);
+    });
+}
 
-    // number of proposers (men)
-    int M = proposerPref.n_cols;
+//' Validate the inputs of a marriage market and compute the Gale-Shapley algorithm
+//'
+//' This function takes the preferences of both sides of the market either as
+//' cardinal utilities or as preference orders (in R or C++ indexing). It
+//' checks that preference orders are complete and turns the inputs into the
+//' tables that the algorithm uses in a single pass: the proposers' preference
+//' orders and, if the reviewers' preferences are ordinal, the ranks that the
+//' reviewers assign to the proposers. Cardinal utilities of the reviewers are
+//' used as they are. Integer and numeric matrices are read in place and not
+//' copied. Users should not call this function directly and instead use
+//' \code{\link{galeShapley.marriageMarket}}.
+//'
+//' @param proposerInput is a matrix with cardinal utilities or preference
+//'   orders of the proposing side of the market. If there are \code{n}
+//'   proposers and \code{m} reviewers, then this matrix will be of dimension
+//'   \code{m} by \code{n}.
+//' @param reviewerInput is a matrix with cardinal utilities or preference
+//'   orders of the courted side of the market of dimension \code{n} by
+//'   \code{m}.
+//' @param proposerOrdinal is true if \code{proposerInput} contains preference
+//'   orders and false if it contains cardinal utilities.
+//' @param reviewerOrdinal is true if \code{reviewerInput} contains preference
+//'   orders and false if it contains cardinal utilities.
+//' @param parallel is true if the proposals should be made by several threads.
+//'   The reviewers' cardinal utilities are then turned into ranks first. If
+//'   they have ties, the proposals are made sequentially instead, so that the
+//'   result is the same as with \code{FALSE}.
+//' @return  A list with the same elements as the list that is returned by
+//'   \code{\link{cpp_wrapper_galeshapley}}.
+//' @export
+// [[Rcpp::export]]
+List cpp_wrapper_galeshapley_market(SEXP proposerInput, SEXP reviewerInput,
+                                    const bool proposerOrdinal, const bool reviewerOrdinal,
+                                    const bool parallel = false) {
 
-    // number of reviewers (women)
-    int N = proposerPref.n_rows;
+    matchingR::GaleShapleyScratch scratch;
 
-    // initialize engagements, proposals
-    vec engagements(N), proposals(M);
+    return withInputMatrix(proposerInput, [&](const auto& proposerTable) {
+        return withInputMatrix(reviewerInput, [&](const auto& reviewerTable) {
 
-    // create an integer queue of bachelors
-    // the idea of using queues for this problem is borrowed from
-    // http://rosettacode.org/wiki/Stable_marriage_problem#C.2B.2B
-    queue<int> bachelors;
+            // store both tables with the smallest index type that fits the market
+            return withIndexType(std::max(proposerTable.n_rows, reviewerTable.n_rows), [&](auto index) {
 
-    // set all proposals to N (aka no proposals)
-    proposals.fill(N);
+                typedef decltype(index) Index;
 
-    // set all engagements to M (aka no engagements)
-    engagements.fill(M);
+                Mat<Index> reviewerRanks;
+                if (reviewerOrdinal && !readPreferences(reviewerTable, reviewerRanks, true)) {
+                    stop("reviewerPref was defined by the user but is not a complete list of preference orderings.");
+                }
+
+                Mat<Index> proposerPref;
+                if (proposerOrdinal) {
+                    if (!readPreferences(proposerTable, proposerPref, false)) {
+                        stop("proposerPref was defined by the user but is not a complete list of preference orderings.");
+                    }
+                } else {
+                    if (hasMissing(proposerTable)) {
+                        stop("proposerUtils must not contain missing values.");
+                    }
+                    proposerPref = sortPreferences<Index>(proposerTable, proposerTable.n_rows, false);
+                }
 
-    // every proposer starts out as a bachelor
-    for(int iX=M-1; iX >= 0; iX--) {
+                // check inputs
+                if (proposerPref.n_rows != reviewerTable.n_cols) {
+                    stop("The number of rows in the matrix of proposers' preferences must equal the number of columns in the matrix of reviewers' preferences");
+                }
+                if (proposerPref.n_cols != reviewerTable.n_rows) {
+                    stop("The number of columns in the matrix of proposers' preferences must equal the number of rows in the matrix of reviewers' preferences");
+                }
+
+                if (parallel && !reviewerOrdinal) {
+                    if (hasMissing(reviewerTable)) {
+                        stop("reviewerUtils must not contain missing values.");
+                    }
+                    // the threads compare ranks, which are unique within a
+                    // column. If a reviewer is indifferent between two
+                    // proposers, she holds on to the one who proposed first,
+                    // so the matching depends on the order of the proposals
+                    // and only the sequential algorithm gives the same result.
+                    const Mat<Index> reviewerPref = sortPreferences<Index>(reviewerTable, reviewerTable.n_rows, false);
+                    if (hasTies(reviewerTable, reviewerPref)) {
+                        return galeShapleyCardinal(proposerPref, reviewerTable, scratch);
+                    }
+                    reviewerRanks = invertPreferences(reviewerPref);
+                }
+
+                if (reviewerOrdinal || parallel) {
+                    return galeShapleyOrdinal(proposerPref, reviewerRanks, parallel, scratch);
+                }
+                return galeShapleyCardinal(proposerPref, reviewerTable, scratch);
+            });
+        });
+    });
+}
+
+//' C++ wrapper for Gale-Shapley Algorithm for many markets
+//'
+//' This function computes the Gale-Shapley algorithm for many independent
+//' markets of the same size. The markets are solved in parallel, and each
+//' thread reuses its buffers across the markets that it solves. Users should
+//' not call this function directly and instead use
+//' \code{\link{galeShapley.batch}}.
+//'
+//' @param proposerUtils is an array with cardinal utilities of the proposing
+//'   side of the market. If there are \code{n} proposers, \code{m} reviewers,
+//'   and \code{k} markets, then this array will be of dimension \code{m} by
+//'   \code{n} by \code{k}. The \code{i,j,l}th element refers to the payoff
+//'   that proposer \code{j} receives from being matched to reviewer \code{i}
+//'   in market \code{l}.
+//' @param reviewerUtils is an array with cardinal utilities of the courted
+//'   side of the market of dimension \code{n} by \code{m} by \code{k}. The
+//'   \code{i,j,l}th element refers to the payoff that reviewer \code{j}
+//'   receives from being matched to proposer \code{i} in market \code{l}.
+//' @return A list with the following items:
+//'  \itemize{
+//'    \item{\code{proposals} is a matrix of dimension \code{n} by \code{k}
+//'    whose \code{l}th column contains the reviewers that the proposers are
+//'    matched to in market \code{l} (using C++ indexing). Proposers that remain
+//'    unmatched are listed as being matched to \code{m}.}
+//'    \item{\code{engagements} is a matrix of dimension \code{m} by \code{k}
+//'    whose \code{l}th column contains the proposers that the reviewers are
+//'    matched to in market \code{l} (using C++ indexing). Reviewers that remain
+//'    unmatched are listed as being matched to \code{n}.}
+//'    \item{\code{number.of.proposals} is a vector of length \code{k} with the
+//'    number of proposals that were made in each market.}
+//'  }
+//' @export
+// [[Rcpp::export]]
+List cpp_wrapper_galeshapley_batch(const cube& proposerUtils, const cube& reviewerUtils) {
+
+    // number of proposers, reviewers, and markets
+    const uword M = proposerUtils.n_cols;
+    const uword N = proposerUtils.n_rows;
+    const uword K = proposerUtils.n_slices;
+
+    if (reviewerUtils.n_rows != M || reviewerUtils.n_cols != N || reviewerUtils.n_slices != K) {
+        stop("The dimensions of proposerUtils and reviewerUtils do not match.");
+    }
+    if (proposerUtils.has_nan()) {
+        stop("proposerUtils must not contain missing values.");
+    }
+
+    umat proposals(M, K), engagements(N, K);
+    uvec nProposals(K);
+
+    withIndexType(N, [&](auto index) {
+
+        typedef decltype(index) Index;
+
+        #pragma omp parallel
+        {
+            // buffers of this thread
+            matchingR::GaleShapleyScratch scratch;
+            Mat<Index> proposerPref;
+
+            #pragma omp for schedule(dynamic)
+            for (uword kX = 0; kX < K; kX++) {
+                proposerPref = sortPreferences<Index>(proposerUtils.slice(kX), N, false);
+                nProposals(kX) = matchingR::galeShapleyMatching(proposerPref, reviewerUtils.slice(kX), proposals.colptr(kX), engagements.colptr(kX), scratch);
+            }
+        }
+    });
+
+    return List::create(
+      _["proposals"]   = proposals,
+      _["engagements"] = engagements,
+      _["number.of.proposals"] = nProposals);
+}
+
+//' C++ wrapper for Gale-Shapley Algorithm with random tie-breaking
+//'
+//' This function computes the Gale-Shapley algorithm for many draws of a
+//' lottery that breaks the ties in the reviewers' priorities, and counts how
+//' often each proposer is matched to each reviewer. The draws are computed in
+//' parallel and share the reviewers' weak orders. Users should not call this
+//' function directly and instead use \code{\link{galeShapley.lottery}}.
+//'
+//' @param proposerInput is a matrix with cardinal utilities or preference
+//'   orders of the proposing side of the market of dimension \code{m} by
+//'   \code{n}.
+//' @param reviewerClasses is a matrix of dimension \code{n} by \code{m}. The
+//'   \code{i,j}th element is the priority class of proposer \code{i} at
+//'   reviewer \code{j} (lower is better). Proposers in the same class are tied.
+//' @param proposerOrdinal is true if \code{proposerInput} contains preference
+//'   orders and false if it contains cardinal utilities.
+//' @param singleTieBreaking is true if one lottery breaks the ties at all
+//'   reviewers and false if every reviewer draws her own lottery.
+//' @param draws is the number of draws of the lottery.
+//' @param seed is the seed of the random number generators, a non-negative
+//'   whole number below \code{2^64}. Draw \code{d} uses a generator that is
+//'   seeded with \code{seed} and \code{d}, so that the results do not depend
+//'   on the number of threads.
+//' @return A matrix of dimension \code{m + 1} by \code{n}. The \code{i,j}th
+//'   element is the number of draws in which proposer \code{j} is matched to
+//'   reviewer \code{i} (using C++ indexing), where \code{i = m} means that
+//'   proposer \code{j} remains unmatched.
+//' @export
+// [[Rcpp::export]]
+umat cpp_wrapper_galeshapley_lottery(const mat& proposerInput, const mat& reviewerClasses, const bool proposerOrdinal, const bool singleTieBreaking, const uword draws, const double seed) {
+
+    // the seed is converted to an unsigned 64-bit integer, which is only
+    // defined for whole numbers in its range
+    if (!R_FINITE(seed) || seed < 0 || seed != std::floor(seed) || seed >= 18446744073709551616.0) {
+        stop("seed must be a non-negative whole number below 2^64.");
+    }
+    if (reviewerClasses.has_nan()) {
+        stop("reviewerClasses must not contain missing values.");
+    }
+    if (!proposerOrdinal && proposerInput.has_nan()) {
+        stop("proposerUtils must not contain missing values.");
+    }
+
+    // number of proposers and reviewers
+    const uword M = proposerInput.n_cols;
+    const uword N = proposerInput.n_rows;
+
+    if (reviewerClasses.n_rows != M || reviewerClasses.n_cols != N) {
+        stop("The dimensions of the proposers' and the reviewers' preferences do not match.");
+    }
+
+    matchingR::Matrix<std::size_t> counts;
+
+    withIndexType(std::max(M, N), [&](auto index) {
+
+        typedef decltype(index) Index;
+
+        Mat<Index> proposerPref;
+        if (proposerOrdinal) {
+            if (!readPreferences(proposerInput, proposerPref, false)) {
+                stop("proposerPref was defined by the user but is not a complete list of preference orderings.");
+            }
+        } else {
+            proposerPref = sortPreferences<Index>(proposerInput, N, false);
+        }
+
+        // the weak orders are computed once and shared by all draws
+        matchingR::WeakOrders weak;
+        matchingR::weakOrders(reviewerClasses, weak);
+
+        matchingR::lotteryAssignments<Index>(proposerPref, weak,
+                                             singleTieBreaking ? matchingR::SINGLE_TIE_BREAKING : matchingR::MULTIPLE_TIE_BREAKING,
+                                             static_cast<uint64_t>(seed), draws, counts);
+    });
+
+    umat result(N + 1, M);
+    for (uword iX = 0; iX < M; iX++) {
+        for (uword wX = 0; wX <= N; wX++) {
+            result(wX, iX) = counts(wX, iX);
+        }
+    }
+
+    return result;
+}
+
+// Computes the Gale-Shapley algorithm for the preference orders of the
+// proposers and the ranks of the reviewers (see
+// cpp_wrapper_galeshapley_ordinal). Pref and Ranks can be umats or
+// MatrixViews. If parallel is true, proposals are made by several threads.
+template <typename Pref, typename Ranks>
+List galeShapleyOrdinal(const Pref& proposerPref, const Ranks& reviewerRanks, const bool parallel, matchingR::GaleShapleyScratch& scratch) {
+
+    uvec proposals(proposerPref.n_cols), engagements(proposerPref.n_rows);
+
+    scratch.statistics.phase("preprocessing");
+    const uword nProposals = parallel
+      ? matchingR::galeShapleyMatchingParallel(proposerPref, reviewerRanks, proposals.begin(), engagements.begin(), scratch)
+      : matchingR::galeShapleyMatchingOrdinal(proposerPref, reviewerRanks, proposals.begin(), engagements.begin(), scratch);
+    scratch.statistics.phase("matching");
+
+    return addStatistics(List::create(
+      _["proposals"]   = proposals,
+      _["engagements"] = engagements,
+      _["number.of.proposals"] = nProposals), scratch.statistics);
+}
+
+//' C++ wrapper for Gale-Shapley Algorithm with ordinal preferences
+//'
+//' This function is a variant of \code{\link{cpp_wrapper_galeshapley}} for
+//' markets in which the preferences of the reviewers are given as ranks. A
+//' reviewer only needs to compare the rank of a new proposer with the rank of
+//' the proposer that she is currently holding on to, which is stored alongside
+//' the engagements. Each proposal therefore reads a single integer from the
+//' reviewer's column of ranks. Users should not call this function directly and
+//' instead use \code{\link{galeShapley.marriageMarket}}.
+//'
+//' @param proposerPref is a matrix with the preference order of the proposing
+//'   side of the market. If there are \code{n} proposers and \code{m} reviewers
+//'   in the market, then this matrix will be of dimension \code{m} by \code{n}.
+//'   The \code{i,j}th element refers to \code{j}'s \code{i}th most favorite
+//'   partner. Preference orders must be complete and specified using C++
+//'   indexing (starting at 0).
+//' @param reviewerRanks is a matrix with the ranks that the courted side of the
+//'   market assigns to the proposers. If there are \code{n} proposers and
+//'   \code{m} reviewers, then this matrix will be of dimension \code{n} by
+//'   \code{m}. The \code{i,j}th element refers to the rank of proposer \code{i}
+//'   in reviewer \code{j}'s preference order, where \code{0} is the most
+//'   preferred proposer. This is the output of \code{\link{rankIndex}}.
+//' @return  A list with the same elements as the list that is returned by
+//'   \code{\link{cpp_wrapper_galeshapley}}.
+//' @export
+// [[Rcpp::export]]
+List cpp_wrapper_galeshapley_ordinal(SEXP proposerPref, SEXP reviewerRanks) {
+    matchingR::GaleShapleyScratch scratch;
+    return withMatrixView(proposerPref, [&](const auto& pref) {
+        return withMatrixView(reviewerRanks, [&](const auto& ranks) {
+            return galeShapleyOrdinal(pref, ranks, false, scratch);
+        });
+    });
+}
+
+// Computes the college admissions problem (see
+// cpp_wrapper_galeshapley_college). Pref can be a umat or a MatrixView.
+template <typename Pref>
+List galeShapleyCollege(const Pref& proposerPref, const mat& reviewerUtils, const uvec& slots, const bool studentOptimal) {
+
+    // number of proposers and reviewers
+    const uword nProposers = proposerPref.n_cols;
+    const uword nReviewers = proposerPref.n_rows;
+
+    // number of students (n) and colleges (m)
+    const uword n = studentOptimal ? nProposers : nReviewers;
+    const uword m = studentOptimal ? nReviewers : nProposers;
+
+    if (slots.n_elem != m) {
+        stop("slots must have as many elements as there are colleges.");
+    }
+
+    // every college needs at least one column in the matrix of admitted students
+    const uword maxSlots = m > 0 ? std::max(slots.max(), (uword) 1) : 1;
+
+    // the college that each student is matched to (`m` means unmatched)
+    uvec matchedStudents(n);
+    matchedStudents.fill(m);
+
+    // the students that each college admitted (`n` means an open slot)
+    umat matchedColleges(m, maxSlots);
+    matchedColleges.fill(n);
+
+    // position in each proposer's preference list of the next proposal
+    uvec nextProposal(nProposers);
+    nextProposal.zeros();
+
+    // total number of proposals made
+    uword nProposals = 0;
+
+    // queue of proposers with at least one proposal left to make
+    queue<uword> bachelors;
+    for (uword iX = 0; iX < nProposers; iX++) {
         bachelors.push(iX);
     }
 
-    // loop until there are no more proposals to be made
-    while (!bachelors.empty()) {
+    if (studentOptimal) {
+
+        // each college holds on to its current applicants in a min-heap that is
+        // ordered by the college's utility, so that the least preferred current
+        // applicant is always on top
+        typedef pair<double, uword> applicant;
+        typedef priority_queue<applicant, vector<applicant>, greater<applicant> > applicants;
+        vector<applicants> admitted(m);
+
+        while (!bachelors.empty()) {
+
+            // get the index of the student
+            const uword student = bachelors.front();
+            bachelors.pop();
+
+            // apply to the most preferred college that has not rejected student yet
+            while (nextProposal(student) < m) {
+
+                const uword college = proposerPref(nextProposal(student)++, student);
+                nProposals++;
+                const double util = reviewerUtils(student, college);
+
+                // college has an open slot
+                if (admitted[college].size() < slots(college)) {
+                    admitted[college].push(applicant(util, student));
+                    matchedStudents(student) = college;
+                    break;
+                }
 
-        // get the index of the proposer
-        int proposer = bachelors.front();
+                // college is full, check if student can replace the least
+                // preferred applicant
+                if (!admitted[college].empty() && util > admitted[college].top().first) {
 
-        // get the proposer's preferences: we use a raw pointer to the memory
-        // used by the column `proposer` for performance reasons (this is to avoid
-        // making a copy of the proposers vector of preferences)
-        const uword * proposerPrefcol = proposerPref.colptr(proposer);
+                    // the least preferred applicant becomes unmatched
+                    const uword rejected = admitted[college].top().second;
+                    admitted[college].pop();
+                    matchedStudents(rejected) = m;
+                    bachelors.push(rejected);
 
-        // find the best available match for proposer
-        for(int jX=0; jX<N; jX++) {
+                    // student takes the open slot
+                    admitted[college].push(applicant(util, student));
+                    matchedStudents(student) = college;
+                    break;
+                }
+            }
+        }
+
+        // fill the slots from the least preferred applicant upwards
+        for (uword jX = 0; jX < m; jX++) {
+            for (uword sX = admitted[jX].size(); sX > 0; sX--) {
+                matchedColleges(jX, sX - 1) = admitted[jX].top().second;
+                admitted[jX].pop();
+            }
+        }
+
+    } else {
+
+        // number of students that each college currently holds on to
+        uvec filled(m);
+        filled.zeros();
+
+        while (!bachelors.empty()) {
+
+            // get the index of the college
+            const uword college = bachelors.front();
+            bachelors.pop();
+
+            // make offers until all slots are filled or no students are left
+            while (filled(college) < slots(college) && nextProposal(college) < n) {
 
-            // get the index of the reviewer that the proposer is interested in
-            // by dereferencing the pointer; increment the pointer after use (not its value)
-            const uword wX = *proposerPrefcol++;
+                const uword student = proposerPref(nextProposal(college)++, college);
+                nProposals++;
+                const uword current = matchedStudents(student);
 
-            // check if wX is available (`M` means unmatched)
-            if(engagements(wX)==M) {
+                // student is available or prefers college over the current match
+                if (current == m || reviewerUtils(college, student) > reviewerUtils(current, student)) {
 
-                // if available, then form a match
-                engagements(wX) = proposer;
-                proposals(proposer) = wX;
+                    // the student's previous college gets a slot back
+                    if (current != m) {
+                        filled(current)--;
+                        bachelors.push(current);
+                    }
+
+                    matchedStudents(student) = college;
+                    filled(college)++;
+                }
+            }
+        }
 
-                // go to the next proposer
-                break;
+        // fill the slots in the order of the college's preferences
+        for (uword jX = 0; jX < m; jX++) {
+            uword sX = 0;
+            for (uword iX = 0; iX < nextProposal(jX) && sX < filled(jX); iX++) {
+                const uword student = proposerPref(iX, jX);
+                if (matchedStudents(student) == jX) {
+                    matchedColleges(jX, sX++) = student;
+                }
             }
+        }
+    }
+
+    return collegeAdmissionsResult(matchedColleges, matchedStudents, slots, nProposals);
+}
+
+// Turns the matching of the college admissions problem into what
+// galeShapley.collegeAdmissions returns (see
+// cpp_wrapper_galeshapley_college_result). matchedColleges has one row per
+// college and lists the admitted students from the most to the least preferred
+// one, with n for open slots. The first column of matchedStudents has the
+// college of each student, with m for unmatched students. All outputs are
+// built in a single pass over the slots and the students.
+List collegeAdmissionsResult(const umat& matchedColleges, const umat& matchedStudents, const uvec& slots, const uword nProposals) {
 
-            // wX is already matched, let's see if wX can be poached
-            if(reviewerUtils(proposer, wX) > reviewerUtils(engagements(wX), wX)) {
+    // number of students (n) and colleges (m)
+    const uword n = matchedStudents.n_rows;
+    const uword m = matchedColleges.n_rows;
 
-                // wX's previous partner becomes unmatched (`N` means unmatched)
-                proposals(engagements(wX)) = N;
-                bachelors.push(engagements(wX));
+    if (slots.n_elem != m) {
+        stop("slots must have as many elements as there are colleges.");
+    }
+
+    // matched.colleges is a matrix if all colleges have the same number of
+    // slots and a list otherwise
+    bool equalSlots = true;
+    for (uword jX = 1; jX < m; jX++) {
+        if (slots(jX) != slots(0)) {
+            equalSlots = false;
+            break;
+        }
+    }
+
+    IntegerMatrix collegesMatrix(equalSlots ? m : 0, equalSlots && m > 0 ? slots(0) : 0);
+    List collegesList(equalSlots ? 0 : m);
+    vector<int> unmatchedColleges;
 
-                // proposer and wX form a match
-                engagements(wX) = proposer;
-                proposals(proposer) = wX;
+    // the student in slot sX of college jX in R indexing, or NA for an open
+    // slot, which is also recorded in unmatchedColleges
+    auto admittedStudent = [&](const uword jX, const uword sX) {
+        const uword student = sX < matchedColleges.n_cols ? matchedColleges(jX, sX) : n;
+        if (student == n) {
+            unmatchedColleges.push_back(jX + 1);
+            return static_cast<int>(NA_INTEGER);
+        }
+        return static_cast<int>(student + 1);
+    };
 
-                // go to the next proposer
-                break;
+    for (uword jX = 0; jX < m; jX++) {
+        if (equalSlots) {
+            for (uword sX = 0; sX < slots(jX); sX++) {
+                collegesMatrix(jX, sX) = admittedStudent(jX, sX);
             }
+        } else {
+            IntegerVector admitted(slots(jX));
+            for (uword sX = 0; sX < slots(jX); sX++) {
+                admitted[sX] = admittedStudent(jX, sX);
+            }
+            collegesList[jX] = admitted;
+        }
+    }
+
+    IntegerMatrix students(n, 1);
+    vector<int> unmatchedStudents;
+
+    for (uword iX = 0; iX < n; iX++) {
+        const uword college = matchedStudents(iX, 0);
+        if (college == m) {
+            students(iX, 0) = NA_INTEGER;
+            unmatchedStudents.push_back(iX + 1);
+        } else {
+            students(iX, 0) = college + 1;
         }
+    }
+
+    return List::create(
+      _["unmatched.students"] = IntegerVector(unmatchedStudents.begin(), unmatchedStudents.end()),
+      _["unmatched.colleges"] = IntegerVector(unmatchedColleges.begin(), unmatchedColleges.end()),
+      _["matched.colleges"] = equalSlots ? RObject(collegesMatrix) : RObject(collegesList),
+      _["matched.students"] = students,
+      _["number.of.proposals"] = nProposals);
+}
+
+//' C++ wrapper for assembling the result of the college admissions problem
+//'
+//' This function turns a matching of students to colleges from the C++ backend
+//' into the result of \code{\link{galeShapley.collegeAdmissions}}: it converts
+//' the matching to R indexing, replaces open slots and unmatched students by
+//' \code{NA}, and collects the unmatched students and the colleges with open
+//' slots. Everything is done in one pass over the slots and the students.
+//' Users should not call this function directly and instead use
+//' \code{\link{galeShapley.collegeAdmissions}}.
+//'
+//' @param matchedColleges is a matrix with \code{m} rows whose \code{j}th row
+//'   contains the students that college \code{j} admitted (using C++
+//'   indexing), ordered from the college's most to its least preferred student.
+//'   Open slots are listed as being matched to \code{n}. It needs as many
+//'   columns as the largest college has slots.
+//' @param matchedStudents is a matrix with \code{n} rows whose first column
+//'   contains the college that each student is matched to (using C++
+//'   indexing). Unmatched students are listed as being matched to \code{m}.
+//' @param slots is a vector with the number of slots at each college.
+//' @param nProposals is the total number of proposals that were made.
+//' @return A list with the elements \code{unmatched.students},
+//'   \code{unmatched.colleges}, \code{matched.colleges},
+//'   \code{matched.students}, and \code{number.of.proposals} as described in
+//'   \code{\link{galeShapley.collegeAdmissions}}. All indices are integers.
+//' @export
+// [[Rcpp::export]]
+List cpp_wrapper_galeshapley_college_result(const umat& matchedColleges, const umat& matchedStudents, const uvec& slots, const uword nProposals) {
+    return collegeAdmissionsResult(matchedColleges, matchedStudents, slots, nProposals);
+}
+
+//' C++ wrapper for Gale-Shapley Algorithm with multiple slots
+//'
+//' This function provides an R wrapper for the C++ backend of the college
+//' admissions problem. Instead of creating one copy of each college for every
+//' slot, it keeps track of the set of students that each college currently
+//' holds on to. Users should not call this function directly and instead use
+//' \code{\link{galeShapley.collegeAdmissions}}.
+//'
+//' @param proposerPref is a matrix with the preference order of the proposing
+//'   side of the market. If there are \code{n} proposers and \code{m} reviewers
+//'   in the market, then this matrix will be of dimension \code{m} by \code{n}.
+//'   The \code{i,j}th element refers to \code{j}'s \code{i}th most favorite
+//'   partner. Preference orders must be complete and specified using C++
+//'   indexing (starting at 0).
+//' @param reviewerUtils is a matrix with cardinal utilities of the courted side
+//'   of the market. If there are \code{n} proposers and \code{m} reviewers, then
+//'   this matrix will be of dimension \code{n} by \code{m}. The \code{i,j}th
+//'   element refers to the payoff that individual \code{j} receives from being
+//'   matched to individual \code{i}.
+//' @param slots is a vector with the number of slots at each college.
+//' @param studentOptimal is \code{TRUE} if students are the proposing side of
+//'   the market and \code{FALSE} if colleges are the proposing side of the
+//'   market.
+//' @return A list with the elements \code{unmatched.students},
+//'   \code{unmatched.colleges}, \code{matched.colleges},
+//'   \code{matched.students}, and \code{number.of.proposals} as described in
+//'   \code{\link{galeShapley.collegeAdmissions}}, assembled by
+//'   \code{\link{cpp_wrapper_galeshapley_college_result}}.
+//' @export
+// [[Rcpp::export]]
+List cpp_wrapper_galeshapley_college(SEXP proposerPref, const mat& reviewerUtils, const uvec& slots, const bool studentOptimal = true) {
+    return withMatrixView(proposerPref, [&](const auto& pref) {
+        return galeShapleyCollege(pref, reviewerUtils, slots, studentOptimal);
+    });
+}
+
+
+// Computes the Gale-Shapley algorithm for truncated preference lists in
+// compressed sparse row format (see cpp_wrapper_galeshapley_sparse). Ptr and
+// Idx can be uvecs or MatrixViews, e.g. of a memory-mapped preference file.
+template <typename ProposerPtr, typename ProposerIdx, typename ReviewerPtr, typename ReviewerIdx>
+List galeShapleySparse(const ProposerPtr& proposerPtr, const ProposerIdx& proposerIdx,
+                       const ReviewerPtr& reviewerPtr, const ReviewerIdx& reviewerIdx,
+                       const uvec& proposerSlots, const uvec& reviewerSlots) {
+
+    if (!validOffsets(proposerPtr, proposerIdx.n_elem) || !validOffsets(reviewerPtr, reviewerIdx.n_elem)) {
+        stop("Invalid preference lists: offsets do not match the number of listed partners.");
+    }
 
-        // remove proposer from bachelor queue: proposer will remain unmatched
+    // number of proposers and reviewers
+    const uword M = proposerPtr.n_elem - 1;
+    const uword N = reviewerPtr.n_elem - 1;
+
+    // rank that marks a pair as unacceptable
+    const uword UNACCEPTABLE = static_cast<uword>(-1);
+
+    if (proposerSlots.n_elem != M || reviewerSlots.n_elem != N) {
+        stop("slots must have as many elements as there are agents on each side of the market.");
+    }
+
+    // transpose the reviewers' lists, so that every proposer knows which
+    // reviewers list him and at which rank
+    uvec transposedPtr(M + 1);
+    transposedPtr.zeros();
+    for (uword kX = 0; kX < reviewerIdx.n_elem; kX++) {
+        if (reviewerIdx(kX) >= M) {
+            stop("Invalid preference lists: reviewers' preferences refer to a proposer that does not exist.");
+        }
+        transposedPtr(reviewerIdx(kX) + 1)++;
+    }
+    for (uword iX = 0; iX < M; iX++) {
+        transposedPtr(iX + 1) += transposedPtr(iX);
+    }
+
+    uvec transposedReviewer(reviewerIdx.n_elem), transposedRank(reviewerIdx.n_elem);
+    {
+        uvec fill = transposedPtr;
+        for (uword jX = 0; jX < N; jX++) {
+            for (uword kX = reviewerPtr(jX); kX < reviewerPtr(jX + 1); kX++) {
+                const uword pos = fill(reviewerIdx(kX))++;
+                transposedReviewer(pos) = jX;
+                transposedRank(pos) = kX - reviewerPtr(jX);
+            }
+        }
+    }
+
+    // for every entry in a proposer's list, the rank of that proposer in the
+    // reviewer's list (UNACCEPTABLE if the reviewer does not list him)
+    uvec rankAt(proposerIdx.n_elem);
+    rankAt.fill(UNACCEPTABLE);
+
+    // position of each reviewer in the current proposer's list
+    uvec position(N);
+    position.fill(UNACCEPTABLE);
+
+    for (uword iX = 0; iX < M; iX++) {
+        for (uword kX = proposerPtr(iX); kX < proposerPtr(iX + 1); kX++) {
+            if (proposerIdx(kX) >= N) {
+                stop("Invalid preference lists: proposers' preferences refer to a reviewer that does not exist.");
+            }
+            if (position(proposerIdx(kX)) != UNACCEPTABLE) {
+                stop("Invalid preference lists: proposers' preferences contain duplicates.");
+            }
+            position(proposerIdx(kX)) = kX;
+        }
+        for (uword kX = transposedPtr(iX); kX < transposedPtr(iX + 1); kX++) {
+            const uword pos = position(transposedReviewer(kX));
+            if (pos != UNACCEPTABLE) {
+                if (rankAt(pos) != UNACCEPTABLE) {
+                    stop("Invalid preference lists: reviewers' preferences contain duplicates.");
+                }
+                rankAt(pos) = transposedRank(kX);
+            }
+        }
+        for (uword kX = proposerPtr(iX); kX < proposerPtr(iX + 1); kX++) {
+            position(proposerIdx(kX)) = UNACCEPTABLE;
+        }
+    }
+
+    // each reviewer holds on to its current proposers in a max-heap that is
+    // ordered by rank, so that the least preferred proposer is always on top
+    typedef pair<uword, uword> proposal;
+    vector< priority_queue<proposal> > held(N);
+
+    // position in each proposer's preference list of the next proposal
+    uvec nextProposal(M);
+    for (uword iX = 0; iX < M; iX++) {
+        nextProposal(iX) = proposerPtr(iX);
+    }
+
+    // number of reviewers that currently hold on to each proposer
+    uvec filled(M);
+    filled.zeros();
+
+    // total number of proposals made
+    uword nProposals = 0;
+
+    queue<uword> bachelors;
+    for (uword iX = 0; iX < M; iX++) {
+        bachelors.push(iX);
+    }
+
+    while (!bachelors.empty()) {
+
+        const uword proposer = bachelors.front();
         bachelors.pop();
+
+        // make proposals until all slots are filled or the list is exhausted
+        while (filled(proposer) < proposerSlots(proposer) && nextProposal(proposer) < proposerPtr(proposer + 1)) {
+
+            const uword kX = nextProposal(proposer)++;
+            const uword rank = rankAt(kX);
+
+            // the reviewer does not find the proposer acceptable
+            if (rank == UNACCEPTABLE) {
+                continue;
+            }
+
+            const uword wX = proposerIdx(kX);
+            nProposals++;
+
+            // wX has an open slot
+            if (held[wX].size() < reviewerSlots(wX)) {
+                held[wX].push(proposal(rank, kX));
+                filled(proposer)++;
+                continue;
+            }
+
+            // wX is full, check if the proposer can replace the least preferred
+            // proposer that wX is holding on to
+            if (!held[wX].empty() && rank < held[wX].top().first) {
+
+                const uword rejected = reviewerIdx(reviewerPtr(wX) + held[wX].top().first);
+                held[wX].pop();
+                filled(rejected)--;
+                bachelors.push(rejected);
+
+                held[wX].push(proposal(rank, kX));
+                filled(proposer)++;
+            }
+        }
+    }
+
+    // mark the entries of the proposers' lists that were accepted
+    uvec accepted(proposerIdx.n_elem);
+    accepted.zeros();
+
+    // fill the reviewers' slots from the least preferred proposer upwards
+    const uword maxReviewerSlots = N > 0 ? std::max(reviewerSlots.max(), (uword) 1) : 1;
+    umat engagements(N, maxReviewerSlots);
+    engagements.fill(M);
+    for (uword jX = 0; jX < N; jX++) {
+        for (uword sX = held[jX].size(); sX > 0; sX--) {
+            engagements(jX, sX - 1) = reviewerIdx(reviewerPtr(jX) + held[jX].top().first);
+            accepted(held[jX].top().second) = 1;
+            held[jX].pop();
+        }
+    }
+
+    // fill the proposers' slots in the order of their preferences
+    const uword maxProposerSlots = M > 0 ? std::max(proposerSlots.max(), (uword) 1) : 1;
+    umat proposals(M, maxProposerSlots);
+    proposals.fill(N);
+    for (uword iX = 0; iX < M; iX++) {
+        uword sX = 0;
+        for (uword kX = proposerPtr(iX); kX < nextProposal(iX); kX++) {
+            if (accepted(kX)) {
+                proposals(iX, sX++) = proposerIdx(kX);
+            }
+        }
     }
 
     return List::create(
       _["proposals"]   = proposals,
-      _["engagements"] = engagements);
+      _["engagements"] = engagements,
+      _["number.of.proposals"] = nProposals);
+}
+
+//' C++ wrapper for Gale-Shapley Algorithm with truncated preference lists
+//'
+//' This function provides an R wrapper for the C++ backend of the
+//' Gale-Shapley algorithm when agents only rank some of the agents on the
+//' other side of the market. Preferences are stored in compressed sparse row
+//' (CSR) format: the preference list of proposer \code{i} is given by the
+//' elements \code{proposerPtr[i]} to \code{proposerPtr[i+1]-1} of
+//' \code{proposerIdx}. A proposer and a reviewer can only be matched if each of
+//' them appears in the other's preference list. Memory and running time are
+//' proportional to the number of listed pairs. Users should not call this
+//' function directly and instead use \code{\link{galeShapley.marriageMarket}}
+//' or \code{\link{galeShapley.collegeAdmissions}}.
+//'
+//' @param proposerPtr is a vector of length \code{n+1} with the offsets of the
+//'   proposers' preference lists in \code{proposerIdx}.
+//' @param proposerIdx is a vector with the concatenated preference lists of the
+//'   proposers (using C++ indexing), each ordered from the most to the least
+//'   preferred reviewer.
+//' @param reviewerPtr is a vector of length \code{m+1} with the offsets of the
+//'   reviewers' preference lists in \code{reviewerIdx}.
+//' @param reviewerIdx is a vector with the concatenated preference lists of the
+//'   reviewers (using C++ indexing), each ordered from the most to the least
+//'   preferred proposer.
+//' @param proposerSlots is a vector of length \code{n} with the number of slots
+//'   of each proposer.
+//' @param reviewerSlots is a vector of length \code{m} with the number of slots
+//'   of each reviewer.
+//' @return  A list with elements that specify who is matched to whom. Suppose
+//'   there are \code{n} proposers and \code{m} reviewers. The list contains the
+//'   following items:
+//'  \itemize{
+//'    \item{\code{proposals} is a matrix with \code{n} rows and as many columns
+//'    as the largest proposer has slots. The \code{i}th row contains the
+//'    reviewers that proposer \code{i} is matched to (using C++ indexing),
+//'    starting with the most preferred one. Open slots are listed as being
+//'    matched to \code{m}.}
+//'    \item{\code{engagements} is a matrix with \code{m} rows and as many
+//'    columns as the largest reviewer has slots. The \code{j}th row contains the
+//'    proposers that reviewer \code{j} is matched to (using C++ indexing),
+//'    starting with the most preferred one. Open slots are listed as being
+//'    matched to \code{n}.}
+//'    \item{\code{number.of.proposals} is the total number of proposals that
+//'    were made.}
+//'  }
+//' @export
+// [[Rcpp::export]]
+List cpp_wrapper_galeshapley_sparse(const uvec& proposerPtr, const uvec& proposerIdx, const uvec& reviewerPtr, const uvec& reviewerIdx, const uvec& proposerSlots, const uvec& reviewerSlots) {
+    return galeShapleySparse(proposerPtr, proposerIdx, reviewerPtr, reviewerIdx, proposerSlots, reviewerSlots);
+}
+
+//' C++ wrapper for repairing a stable matching with truncated preference lists
+//'
+//' This function provides an R wrapper for the C++ backend that repairs a
+//' stable matching after some agents changed their preference lists, joined,
+//' or left the market. Deferred acceptance is restarted only from the
+//' proposers whose partner may be affected by the changes (see
+//' \code{\link{galeShapley.rematch}}), so that the number of proposals
+//' depends on the size of the changes rather than the size of the market.
+//' Reading the inputs and returning the matching still take time
+//' proportional to the number of agents plus the total length of the
+//' preference lists. Preferences are stored in compressed sparse row format
+//' as in \code{\link{cpp_wrapper_galeshapley_sparse}}. Users should not call
+//' this function directly and instead use \code{\link{galeShapley.rematch}}.
+//'
+//' @param proposerPtr is a vector of length \code{n+1} with the offsets of the
+//'   proposers' preference lists in \code{proposerIdx}.
+//' @param proposerIdx is a vector with the concatenated preference lists of the
+//'   proposers (using C++ indexing).
+//' @param reviewerPtr is a vector of length \code{m+1} with the offsets of the
+//'   reviewers' preference lists in \code{reviewerIdx}.
+//' @param reviewerIdx is a vector with the concatenated preference lists of the
+//'   reviewers (using C++ indexing).
+//' @param proposals is a vector of length \code{n} with the previous partner
+//'   of each proposer (using C++ indexing). Proposers that were unmatched or
+//'   are new are listed as being matched to \code{m}.
+//' @param changedProposers is a vector with the proposers (using C++ indexing)
+//'   whose preference lists changed, that are new, or whose partner left the
+//'   market.
+//' @param changedReviewers is a vector with the reviewers (using C++ indexing)
+//'   whose preference lists changed, that are new, or whose partner left the
+//'   market.
+//' @return  A list with elements that specify who is matched to whom. Suppose
+//'   there are \code{n} proposers and \code{m} reviewers. The list contains the
+//'   following items:
+//'  \itemize{
+//'    \item{\code{proposals} is a vector of length \code{n} whose \code{i}th
+//'    element contains the reviewer that proposer \code{i} is matched to
+//'    (using C++ indexing). Unmatched proposers are listed as being matched to
+//'    \code{m}.}
+//'    \item{\code{engagements} is a vector of length \code{m} whose \code{j}th
+//'    element contains the proposer that reviewer \code{j} is matched to
+//'    (using C++ indexing). Unmatched reviewers are listed as being matched to
+//'    \code{n}.}
+//'    \item{\code{number.of.proposals} is the number of proposals that were
+//'    made to repair the matching.}
+//'  }
+//' @export
+// [[Rcpp::export]]
+List cpp_wrapper_galeshapley_rematch(const uvec& proposerPtr, const uvec& proposerIdx, const uvec& reviewerPtr, const uvec& reviewerIdx,
+                                     const uvec& proposals, const uvec& changedProposers, const uvec& changedReviewers) {
+
+    if (!validOffsets(proposerPtr, proposerIdx.n_elem) || !validOffsets(reviewerPtr, reviewerIdx.n_elem)) {
+        stop("Invalid preference lists: offsets do not match the number of listed partners.");
+    }
+
+    // number of proposers and reviewers
+    const uword M = proposerPtr.n_elem - 1;
+    const uword N = reviewerPtr.n_elem - 1;
+
+    if (proposals.n_elem != M) {
+        stop("The previous matching must have as many elements as there are proposers.");
+    }
+
+    // the previous matching from the reviewers' point of view
+    uvec newProposals = proposals;
+    uvec engagements(N);
+    engagements.fill(M);
+    for (uword iX = 0; iX < M; iX++) {
+        if (newProposals(iX) > N) {
+            stop("The previous matching refers to a reviewer that does not exist.");
+        }
+        if (newProposals(iX) < N) {
+            if (engagements(newProposals(iX)) != M) {
+                stop("The previous matching matches a reviewer to more than one proposer.");
+            }
+            engagements(newProposals(iX)) = iX;
+        }
+    }
+
+    std::size_t nProposals = 0;
+    if (!matchingR::galeShapleyRematch(proposerPtr, proposerIdx, reviewerPtr, reviewerIdx, changedProposers, changedReviewers,
+                                       newProposals.begin(), engagements.begin(), nProposals)) {
+        stop("Invalid preference lists or changes: they refer to an agent that does not exist.");
+    }
+
+    return List::create(
+      _["proposals"]   = newProposals,
+      _["engagements"] = engagements,
+      _["number.of.proposals"] = nProposals);
+}
+
+//' C++ wrapper for Gale-Shapley Algorithm with preference files
+//'
+//' This function computes the Gale-Shapley algorithm for preferences that are
+//' stored in preference files (see \code{\link{preferenceFile.write}}). The
+//' files are mapped into memory and read in place, so that R does not allocate
+//' the inputs. Users should not call this function directly and instead use
+//' \code{\link{galeShapley.marriageMarket}}.
+//'
+//' @param proposerFile is the path of a file with the preference orders of the
+//'   proposers. If there are \code{n} proposers and \code{m} reviewers, then it
+//'   contains a dense \code{m} by \code{n} matrix or \code{n} truncated
+//'   preference lists.
+//' @param reviewerFile is the path of a file with the preference orders or the
+//'   ranks of the reviewers. It contains a dense \code{n} by \code{m} matrix
+//'   or \code{m} truncated preference lists. Both files must be dense or both
+//'   must contain truncated lists.
+//' @return  A list with the same elements as the list that is returned by
+//'   \code{\link{cpp_wrapper_galeshapley}} or, for truncated preference lists,
+//'   \code{\link{cpp_wrapper_galeshapley_sparse}}.
+//' @export
+// [[Rcpp::export]]
+List cpp_wrapper_galeshapley_file(const std::string& proposerFile, const std::string& reviewerFile) {
+
+    matchingR::GaleShapleyScratch scratch;
+    const matchingR::PreferenceFile proposers(proposerFile), reviewers(reviewerFile);
+    const matchingR::PreferenceFileHeader& ph = proposers.header();
+    const matchingR::PreferenceFileHeader& rh = reviewers.header();
+
+    // number of proposers and reviewers
+    const uword M = ph.n_cols;
+    const uword N = rh.n_cols;
+
+    if (ph.content != matchingR::PREFERENCE_ORDERS) {
+        stop("The proposers' preference file must contain preference orders.");
+    }
+    if (ph.layout != rh.layout) {
+        stop("Both preference files must be dense or both must contain truncated preference lists.");
+    }
+
+    if (ph.layout == matchingR::CSR) {
+        if (rh.content != matchingR::PREFERENCE_ORDERS) {
+            stop("The reviewers' preference file must contain preference orders.");
+        }
+        if (ph.n_rows != N || rh.n_rows != M) {
+            stop("The preference files do not describe the same market.");
+        }
+        uvec proposerSlots(M), reviewerSlots(N);
+        proposerSlots.ones();
+        reviewerSlots.ones();
+        return matchingR::withCSRView(proposers, [&](const auto& proposerPtr, const auto& proposerIdx) {
+            return matchingR::withCSRView(reviewers, [&](const auto& reviewerPtr, const auto& reviewerIdx) {
+                return galeShapleySparse(proposerPtr, proposerIdx, reviewerPtr, reviewerIdx, proposerSlots, reviewerSlots);
+            });
+        });
+    }
+
+    if (ph.n_rows != N || rh.n_rows != M) {
+        stop("The number of rows in each preference file must equal the number of columns in the other one.");
+    }
+
+    return matchingR::withDenseView(proposers, [&](const auto& proposerPref) {
+        if (!indicesBelow(proposerPref, N)) {
+            stop("The proposers' preference file refers to a reviewer that does not exist.");
+        }
+        return matchingR::withDenseView(reviewers, [&](const auto& reviewerInput) {
+            if (rh.content == matchingR::RANKS) {
+                return galeShapleyOrdinal(proposerPref, reviewerInput, false, scratch);
+            }
+            // turn the reviewers' preference orders into ranks
+            return withIndexType(M, [&](auto index) {
+                typedef decltype(index) Index;
+                Mat<Index> reviewerRanks(M, N);
+                reviewerRanks.fill(M);
+                for (uword jX = 0; jX < N; jX++) {
+                    for (uword iX = 0; iX < M; iX++) {
+                        const uword proposer = reviewerInput(iX, jX);
+                        if (proposer >= M || reviewerRanks(proposer, jX) != M) {
+                            stop("reviewerPref was defined by the user but is not a complete list of preference orderings.");
+                        }
+                        reviewerRanks(proposer, jX) = iX;
+                    }
+                }
+                return galeShapleyOrdinal(proposerPref, reviewerRanks, false, scratch);
+            });
+        });
+    });
 }
 
+// Pairs of a proposer and a reviewer that would rather be matched to each other
+// than to their current partners. Preferences are given as scores, where
+// `prefers(a, b)` is true if an agent strictly prefers a partner with score
+// `a` to a partner with score `b`. The score matrices can be Armadillo
+// matrices or MatrixViews of R matrices, so that they are not copied. Every
+// agent is only compared to its least preferred partner, so that each pair is
+// visited once.
+template <typename ProposerScores, typename ReviewerScores, typename Prefers>
+struct BlockingPairs {
+
+    const ProposerScores& proposerScores;
+    const ReviewerScores& reviewerScores;
+    const umat& proposals;
+    const umat& engagements;
+    const Prefers prefers;
+
+    // score of each agent's least preferred partner (`openSlot` if a slot is open)
+    const vec worstProposer;
+    const vec worstReviewer;
+
+    BlockingPairs(const ProposerScores& proposerScores_, const ReviewerScores& reviewerScores_,
+                  const umat& proposals_, const umat& engagements_,
+                  const double openSlot, const Prefers prefers_) :
+        proposerScores(proposerScores_), reviewerScores(reviewerScores_),
+        proposals(proposals_), engagements(engagements_), prefers(prefers_),
+        worstProposer(worstPartner(proposerScores_, proposals_, openSlot)),
+        worstReviewer(worstPartner(reviewerScores_, engagements_, openSlot)) {}
+
+    template <typename Scores>
+    vec worstPartner(const Scores& scores, const umat& partners, const double openSlot) const {
+        vec worst(scores.n_cols);
+        #pragma omp parallel for schedule(static)
+        for (uword kX = 0; kX < scores.n_cols; kX++) {
+            double score = openSlot;
+            for (uword sX = 0; sX < partners.n_cols; sX++) {
+                const double partnerScore = partners(kX, sX) >= scores.n_rows ? openSlot : static_cast<double>(scores(partners(kX, sX), kX));
+                if (sX == 0 || prefers(score, partnerScore)) {
+                    score = partnerScore;
+                }
+            }
+            worst(kX) = score;
+        }
+        return worst;
+    }
+
+    // check if iX and jX would rather be matched with each other than with
+    // their actual matches
+    bool blocks(const uword iX, const uword jX) const {
+        if (!prefers(static_cast<double>(reviewerScores(iX, jX)), worstReviewer(jX)) ||
+            !prefers(static_cast<double>(proposerScores(jX, iX)), worstProposer(iX))) {
+            return false;
+        }
+        // agents with multiple slots may already be matched to each other
+        for (uword sX = 0; sX < proposals.n_cols; sX++) {
+            if (proposals(iX, sX) == jX) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    // number of blocking pairs that each proposer is part of
+    uvec count() const {
+
+        const uword M = proposerScores.n_cols;
+        const uword N = proposerScores.n_rows;
+
+        // proposers are processed in blocks, so that the cache lines of both
+        // score matrices are reused across neighboring proposers and reviewers
+        const uword blockSize = 64;
+        const uword nBlocks = (M + blockSize - 1) / blockSize;
+
+        uvec counts(M);
+        counts.zeros();
+
+        #pragma omp parallel for schedule(dynamic)
+        for (uword bX = 0; bX < nBlocks; bX++) {
+            const uword first = bX * blockSize;
+            const uword last = std::min(first + blockSize, M);
+            for (uword jX = 0; jX < N; jX++) {
+                for (uword iX = first; iX < last; iX++) {
+                    counts(iX) += blocks(iX, jX);
+                }
+            }
+        }
+        return counts;
+    }
+
+    // blocking pairs (one per row) ordered by proposer and reviewer
+    umat pairs(const uvec& counts) const {
+
+        const uword M = proposerScores.n_cols;
+        const uword N = proposerScores.n_rows;
+
+        uvec offsets(M + 1);
+        offsets(0) = 0;
+        for (uword iX = 0; iX < M; iX++) {
+            offsets(iX + 1) = offsets(iX) + counts(iX);
+        }
+
+        umat blockingPairs(offsets(M), 2);
+
+        #pragma omp parallel for schedule(dynamic)
+        for (uword iX = 0; iX < M; iX++) {
+            uword row = offsets(iX);
+            for (uword jX = 0; jX < N && row < offsets(iX + 1); jX++) {
+                if (blocks(iX, jX)) {
+                    blockingPairs(row, 0) = iX;
+                    blockingPairs(row, 1) = jX;
+                    row++;
+                }
+            }
+        }
+        return blockingPairs;
+    }
+
+    // check if there are no blocking pairs, warn about the first one otherwise
+    bool stable(const char* message) const {
+        const uvec counts = count();
+        for (uword iX = 0; iX < counts.n_elem; iX++) {
+            for (uword jX = 0; counts(iX) > 0 && jX < proposerScores.n_rows; jX++) {
+                if (blocks(iX, jX)) {
+                    ::Rf_warning(message, (int) iX, (int) jX);
+                    return false;
+                }
+            }
+        }
+        return true;
+    }
+};
 
 //' C++ Wrapper to Check Stability of Two-sided Matching
 //'
@@ -167,51 +1263,145 @@ List cpp_wrapper_galeshapley(const umat& proposerPref, const mat& reviewerUtils)
 //' @return true if the matching is stable, false otherwise
 //' @export
 // [[Rcpp::export]]
-bool cpp_wrapper_galeshapley_check_stability(mat proposerUtils, mat reviewerUtils, umat proposals, umat engagements) {
+bool cpp_wrapper_galeshapley_check_stability(const mat& proposerUtils, const mat& reviewerUtils, const umat& proposals, const umat& engagements) {
 
-    // number of workers
-    const int M = proposerUtils.n_cols;
+    // open slots are worse than any partner
+    const BlockingPairs< mat, mat, std::greater<double> > check(
+        proposerUtils, reviewerUtils, proposals, engagements,
+        -std::numeric_limits<double>::infinity(), std::greater<double>());
 
-    // number of firms
-    const int N = proposerUtils.n_rows;
+    return check.stable("matching is not stable; worker %d would rather be matched to firm %d and vice versa.\n");
+}
 
-    // number of slots per firm
-    const int slotsReviewers = engagements.n_cols;
+//' C++ Wrapper to Check Stability of Two-sided Matching with Ordinal Preferences
+//'
+//' This function checks if a given matching is stable for a particular set of
+//' ordinal preferences. Instead of comparing every pair of slots, it first
+//' computes the rank of the least preferred partner of every agent, so that
+//' every pair of a proposer and a reviewer is only visited once. Integer and
+//' numeric matrices are read in place and not copied. This function provides
+//' an R wrapper for the C++ backend. Users should not call this function
+//' directly.
+//'
+//' @param proposerRanks is a matrix with the ranks that the proposing side of
+//'   the market assigns to the reviewers. If there are \code{n} proposers and
+//'   \code{m} reviewers, then this matrix will be of dimension \code{m} by
+//'   \code{n}. The \code{i,j}th element refers to the rank of reviewer
+//'   \code{i} in proposer \code{j}'s preference order, where \code{0} is the
+//'   most preferred reviewer.
+//' @param reviewerRanks is a matrix with the ranks that the courted side of the
+//'   market assigns to the proposers. If there are \code{n} proposers and
+//'   \code{m} reviewers, then this matrix will be of dimension \code{n} by
+//'   \code{m}. The \code{i,j}th element refers to the rank of proposer
+//'   \code{i} in reviewer \code{j}'s preference order.
+//' @param proposals is a matrix that contains the number of the reviewer that a
+//'   given proposer is matched to (using C++ indexing). Unmatched slots are
+//'   denoted by \code{m}. The column dimension accommodates proposers with
+//'   multiple slots.
+//' @param engagements is a matrix that contains the number of the proposer that
+//'   a given reviewer is matched to (using C++ indexing). Unmatched slots are
+//'   denoted by \code{n}. The column dimension accommodates reviewers with
+//'   multiple slots.
+//' @return true if the matching is stable, false otherwise
+//' @export
+// [[Rcpp::export]]
+bool cpp_wrapper_galeshapley_check_stability_ordinal(SEXP proposerRanks, SEXP reviewerRanks, const umat& proposals, const umat& engagements) {
 
-    // number of slots per worker
-    const int slotsProposers = proposals.n_cols;
+    return withMatrixView(proposerRanks, [&](const auto& proposerView) {
+        return withMatrixView(reviewerRanks, [&](const auto& reviewerView) {
+            // open slots are worse than any partner
+            const BlockingPairs< std::decay_t<decltype(proposerView)>, std::decay_t<decltype(reviewerView)>, std::less<double> > check(
+                proposerView, reviewerView, proposals, engagements,
+                std::numeric_limits<double>::infinity(), std::less<double>());
 
-    // more jobs than workers (add utility from being unmatched to firms' preferences)
-    if(N*slotsReviewers>M*slotsProposers) {
-        reviewerUtils.insert_rows(M, 1);
-        reviewerUtils.row(M).fill(-1e10);
-    }
-    // more workers than jobs (add utility from being unmatched to workers' preferences)
-    if(M*slotsProposers>N*slotsReviewers) {
-        proposerUtils.insert_rows(N, 1);
-        proposerUtils.row(N).fill(-1e10);
-    }
+            return check.stable("matching is not stable; proposer %d would rather be matched to reviewer %d and vice versa.\n");
+        });
+    });
+}
 
-    // loop over workers
-    for(int wX=0; wX<M; wX++) {
+// Returns the blocking pairs found by check as in
+// cpp_wrapper_galeshapley_blocking_pairs
+template <typename Check>
+List blockingPairsList(const Check& check, const bool countOnly) {
 
-        // loop over firms
-        for(int fX=0; fX<N; fX++) {
+    const uvec counts = check.count();
 
-            // loop over multiple "slots" at the same worker
-            for(int swX=0;swX<slotsProposers;swX++) {
+    return List::create(
+      _["blocking.pairs"] = countOnly ? umat(0, 2) : check.pairs(counts),
+      _["number.of.blocking.pairs"] = sum(counts));
+}
 
-                // loop over multiple slots at the same firm
-                for(int sfX=0;sfX<slotsReviewers;sfX++) {
+//' C++ Wrapper to Compute the Blocking Pairs of a Two-sided Matching
+//'
+//' This function finds all pairs of a proposer and a reviewer who would both
+//' rather be matched to each other than to (one of) their current partners.
+//' Preferences are given either as ranks, so that smaller numbers are
+//' preferred, or as cardinal utilities, so that larger numbers are preferred.
+//' Each agent is only compared to its least preferred partner, so that the
+//' running time is proportional to \code{n*m}. The pairs are checked in
+//' parallel. Integer and numeric matrices are read in place and not copied.
+//' Users should not call this function directly and instead use
+//' \code{\link{galeShapley.blockingPairs}}.
+//'
+//' @param proposerScores is a matrix with the ranks (or utilities) that the
+//'   proposing side of the market assigns to the reviewers. If there are
+//'   \code{n} proposers and \code{m} reviewers, then this matrix will be of
+//'   dimension \code{m} by \code{n}. The \code{i,j}th element refers to the
+//'   rank of reviewer \code{i} in proposer \code{j}'s preference order (or to
+//'   the payoff that proposer \code{j} receives from being matched to
+//'   reviewer \code{i}).
+//' @param reviewerScores is a matrix with the ranks (or utilities) that the
+//'   courted side of the market assigns to the proposers. If there are
+//'   \code{n} proposers and \code{m} reviewers, then this matrix will be of
+//'   dimension \code{n} by \code{m}. The \code{i,j}th element refers to the
+//'   rank of proposer \code{i} in reviewer \code{j}'s preference order (or to
+//'   the payoff that reviewer \code{j} receives from being matched to
+//'   proposer \code{i}).
+//' @param proposals is a matrix that contains the number of the reviewer that a
+//'   given proposer is matched to (using C++ indexing). Unmatched slots are
+//'   denoted by \code{m}. The column dimension accommodates proposers with
+//'   multiple slots.
+//' @param engagements is a matrix that contains the number of the proposer that
+//'   a given reviewer is matched to (using C++ indexing). Unmatched slots are
+//'   denoted by \code{n}. The column dimension accommodates reviewers with
+//'   multiple slots.
+//' @param countOnly is \code{TRUE} if only the number of blocking pairs is
+//'   required.
+//' @param utilities is \code{TRUE} if \code{proposerScores} and
+//'   \code{reviewerScores} contain cardinal utilities, where larger numbers are
+//'   preferred, and \code{FALSE} if they contain ranks (non-negative
+//'   integers), where smaller numbers are preferred.
+//' @return A list with the following items:
+//'  \itemize{
+//'    \item{\code{blocking.pairs} is a matrix with two columns. Each row
+//'    contains a proposer and a reviewer that form a blocking pair (using C++
+//'    indexing), ordered by proposer and reviewer. This matrix has no rows if
+//'    \code{countOnly} is \code{TRUE}.}
+//'    \item{\code{number.of.blocking.pairs} is the number of blocking pairs.}
+//'  }
+//' @export
+// [[Rcpp::export]]
+List cpp_wrapper_galeshapley_blocking_pairs(SEXP proposerScores, SEXP reviewerScores, const umat& proposals, const umat& engagements,
+                                            const bool countOnly = false, const bool utilities = false) {
 
-                    // check if wX and fX would rather be matched with each other than with their actual matches
-                    if(reviewerUtils(wX, fX) > reviewerUtils(engagements(fX, sfX), fX) && proposerUtils(fX, wX) > proposerUtils(proposals(wX, swX), wX)) {
-                        ::Rf_warning("matching is not stable; worker %d would rather be matched to firm %d and vice versa.\n", wX, fX);
-                        return false;
-                    }
-                }
-            }
-        }
+    // open slots are worse than any partner
+    if (utilities) {
+        return withNumericMatrix(proposerScores, [&](const mat& proposerUtils) {
+            return withNumericMatrix(reviewerScores, [&](const mat& reviewerUtils) {
+                const BlockingPairs< mat, mat, std::greater<double> > check(
+                    proposerUtils, reviewerUtils, proposals, engagements,
+                    -std::numeric_limits<double>::infinity(), std::greater<double>());
+                return blockingPairsList(check, countOnly);
+            });
+        });
     }
-    return true;
+
+    return withMatrixView(proposerScores, [&](const auto& proposerRanks) {
+        return withMatrixView(reviewerScores, [&](const auto& reviewerRanks) {
+            const BlockingPairs< std::decay_t<decltype(proposerRanks)>, std::decay_t<decltype(reviewerRanks)>, std::less<double> > check(
+                proposerRanks, reviewerRanks, proposals, engagements,
+                std::numeric_limits<double>::infinity(), std::less<double>());
+            return blockingPairsList(check, countOnly);
+        });
+    });
 }
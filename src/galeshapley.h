@@ -18,7 +18,28 @@
 #ifndef galeshapley_h
 #define galeshapley_h
 
-List cpp_wrapper_galeshapley(umat& prefM, mat& rankW);
-bool cpp_wrapper_galeshapley_check_stability(mat& uM, mat& uW, umat& proposals, umat& engagements);
+#include <matchingR/galeshapley.h>
+#include <matchingR/lottery.h>
+
+List cpp_wrapper_galeshapley(SEXP proposerPref, const mat& reviewerUtils);
+template <typename Pref, typename Utils>
+List galeShapleyCardinal(const Pref& proposerPref, const Utils& reviewerUtils, matchingR::GaleShapleyScratch& scratch);
+template <typename Pref, typename Ranks>
+List galeShapleyOrdinal(const Pref& proposerPref, const Ranks& reviewerRanks, const bool parallel, matchingR::GaleShapleyScratch& scratch);
+template <typename Pref>
+List galeShapleyCollege(const Pref& proposerPref, const mat& reviewerUtils, const uvec& slots, const bool studentOptimal);
+List cpp_wrapper_galeshapley_market(SEXP proposerInput, SEXP reviewerInput, const bool proposerOrdinal, const bool reviewerOrdinal, const bool parallel);
+List cpp_wrapper_galeshapley_batch(const cube& proposerUtils, const cube& reviewerUtils);
+umat cpp_wrapper_galeshapley_lottery(const mat& proposerInput, const mat& reviewerClasses, const bool proposerOrdinal, const bool singleTieBreaking, const uword draws, const double seed);
+List cpp_wrapper_galeshapley_ordinal(SEXP proposerPref, SEXP reviewerRanks);
+List collegeAdmissionsResult(const umat& matchedColleges, const umat& matchedStudents, const uvec& slots, const uword nProposals);
+List cpp_wrapper_galeshapley_college_result(const umat& matchedColleges, const umat& matchedStudents, const uvec& slots, const uword nProposals);
+List cpp_wrapper_galeshapley_college(SEXP proposerPref, const mat& reviewerUtils, const uvec& slots, const bool studentOptimal);
+List cpp_wrapper_galeshapley_sparse(const uvec& proposerPtr, const uvec& proposerIdx, const uvec& reviewerPtr, const uvec& reviewerIdx, const uvec& proposerSlots, const uvec& reviewerSlots);
+List cpp_wrapper_galeshapley_rematch(const uvec& proposerPtr, const uvec& proposerIdx, const uvec& reviewerPtr, const uvec& reviewerIdx, const uvec& proposals, const uvec& changedProposers, const uvec& changedReviewers);
+List cpp_wrapper_galeshapley_file(const std::string& proposerFile, const std::string& reviewerFile);
+bool cpp_wrapper_galeshapley_check_stability(const mat& proposerUtils, const mat& reviewerUtils, const umat& proposals, const umat& engagements);
+bool cpp_wrapper_galeshapley_check_stability_ordinal(SEXP proposerRanks, SEXP reviewerRanks, const umat& proposals, const umat& engagements);
+List cpp_wrapper_galeshapley_blocking_pairs(SEXP proposerScores, SEXP reviewerScores, const umat& proposals, const umat& engagements, const bool countOnly, const bool utilities);
 
 #endif
@@ -0,0 +1,369 @@
+//  matchingR -- Matching Algorithms in R and C++
+//
+//  Copyright (C) 2015  Jan Tilly <jtilly@econ.upenn.edu>
+//                      Nick Janetos <njanetos@econ.upenn.edu>
+//
+//  This file is part of matchingR.
+//
+//  matchingR is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation, either version 2 of the License, or
+//  (at your option) any later version.
+//
+//  matchingR is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+
+#include "lattice.h"
+
+// [[Rcpp::depends(RcppArmadillo)]]
+
+// Reads the preferences of both sides of a marriage market into preference
+// orders and ranks. The inputs are the same as for
+// cpp_wrapper_galeshapley_market. Ties in cardinal utilities are broken in
+// favor of the agent with the lower index.
+template <typename ProposerInput, typename ReviewerInput, typename Index>
+void readMarket(const ProposerInput& proposerInput, const ReviewerInput& reviewerInput, const bool proposerOrdinal, const bool reviewerOrdinal,
+                Mat<Index>& proposerPref, Mat<Index>& proposerRanks, Mat<Index>& reviewerPref, Mat<Index>& reviewerRanks) {
+
+    if (proposerOrdinal) {
+        if (!readPreferences(proposerInput, proposerPref, false)) {
+            stop("proposerPref was defined by the user but is not a complete list of preference orderings.");
+        }
+    } else {
+        if (hasMissing(proposerInput)) {
+            stop("proposerUtils must not contain missing values.");
+        }
+        proposerPref = sortPreferences<Index>(proposerInput, proposerInput.n_rows, false);
+    }
+
+    if (reviewerOrdinal) {
+        if (!readPreferences(reviewerInput, reviewerPref, false)) {
+            stop("reviewerPref was defined by the user but is not a complete list of preference orderings.");
+        }
+    } else {
+        if (hasMissing(reviewerInput)) {
+            stop("reviewerUtils must not contain missing values.");
+        }
+        reviewerPref = sortPreferences<Index>(reviewerInput, reviewerInput.n_rows, false);
+    }
+
+    // check inputs
+    if (proposerPref.n_rows != reviewerPref.n_cols) {
+        stop("The number of rows in the matrix of proposers' preferences must equal the number of columns in the matrix of reviewers' preferences");
+    }
+    if (proposerPref.n_cols != reviewerPref.n_rows) {
+        stop("The number of columns in the matrix of proposers' preferences must equal the number of rows in the matrix of reviewers' preferences");
+    }
+
+    proposerRanks = invertPreferences(proposerPref);
+    reviewerRanks = invertPreferences(reviewerPref);
+}
+
+// Reads the R matrices of a marriage market in place (see withInputMatrix)
+// with readMarket, storing the tables with the smallest index type that fits
+// the market, and calls f with proposerPref, proposerRanks, reviewerPref and
+// reviewerRanks.
+template <typename F>
+void withMarket(SEXP proposerInput, SEXP reviewerInput, const bool proposerOrdinal, const bool reviewerOrdinal, F f) {
+    withInputMatrix(proposerInput, [&](const auto& proposerTable) {
+        withInputMatrix(reviewerInput, [&](const auto& reviewerTable) {
+            withIndexType(std::max(proposerTable.n_rows, reviewerTable.n_rows), [&](auto index) {
+
+                typedef decltype(index) Index;
+
+                Mat<Index> proposerPref, proposerRanks, reviewerPref, reviewerRanks;
+                readMarket(proposerTable, reviewerTable, proposerOrdinal, reviewerOrdinal, proposerPref, proposerRanks, reviewerPref, reviewerRanks);
+                f(proposerPref, proposerRanks, reviewerPref, reviewerRanks);
+            });
+        });
+    });
+}
+
+// Computes the proposer-optimal matching and the rotation poset of a market.
+template <typename Index>
+void buildLattice(const Mat<Index>& proposerPref, const Mat<Index>& proposerRanks,
+                  const Mat<Index>& reviewerPref, const Mat<Index>& reviewerRanks,
+                  uvec& proposals, uvec& engagements, matchingR::RotationPoset& poset) {
+
+    proposals.set_size(proposerPref.n_cols);
+    engagements.set_size(proposerPref.n_rows);
+    matchingR::GaleShapleyScratch scratch;
+    matchingR::galeShapleyMatchingOrdinal(proposerPref, reviewerRanks, proposals.begin(), engagements.begin(), scratch);
+
+    // rotationPoset ends up at the reviewer-optimal matching
+    uvec finalProposals = proposals, finalEngagements = engagements;
+    matchingR::rotationPoset(proposerPref, proposerRanks, reviewerPref, reviewerRanks,
+                             finalProposals.begin(), finalEngagements.begin(), poset);
+}
+
+//' Computes the proposer-optimal and the reviewer-optimal stable matching
+//'
+//' This function reads the preferences of both sides of a marriage market
+//' once and computes both extremal stable matchings concurrently from the same
+//' preference orders and ranks. Users should not call this function directly
+//' and instead use \code{\link{galeShapley.extremalMatchings}}.
+//'
+//' @param proposerInput is a matrix with cardinal utilities or preference
+//'   orders of the proposing side of the market of dimension \code{m} by
+//'   \code{n}.
+//' @param reviewerInput is a matrix with cardinal utilities or preference
+//'   orders of the courted side of the market of dimension \code{n} by
+//'   \code{m}.
+//' @param proposerOrdinal is true if \code{proposerInput} contains preference
+//'   orders and false if it contains cardinal utilities.
+//' @param reviewerOrdinal is true if \code{reviewerInput} contains preference
+//'   orders and false if it contains cardinal utilities.
+//' @return A list with the following items:
+//'  \itemize{
+//'    \item{\code{proposals} and \code{engagements} hold the proposer-optimal
+//'    matching as in \code{\link{cpp_wrapper_galeshapley_optimal}}.}
+//'    \item{\code{reviewer.proposals} and \code{reviewer.engagements} hold the
+//'    reviewer-optimal matching in the same format.}
+//'    \item{\code{unique.proposers} and \code{unique.reviewers} are the
+//'    proposers and reviewers that are matched to the same partner in every
+//'    stable matching (using C++ indexing). Agents that are unmatched in every
+//'    stable matching are not included.}
+//'    \item{\code{number.of.proposals} is the total number of proposals
+//'    that were made in both runs of the algorithm.}
+//'  }
+//' @export
+// [[Rcpp::export]]
+List cpp_wrapper_galeshapley_extremal(SEXP proposerInput, SEXP reviewerInput, const bool proposerOrdinal, const bool reviewerOrdinal) {
+
+    uvec proposals, engagements, reviewerProposals, reviewerEngagements;
+    uword nProposals = 0;
+
+    withMarket(proposerInput, reviewerInput, proposerOrdinal, reviewerOrdinal,
+               [&](const auto& proposerPref, const auto& proposerRanks, const auto& reviewerPref, const auto& reviewerRanks) {
+
+        proposals.set_size(proposerPref.n_cols);
+        engagements.set_size(proposerPref.n_rows);
+        reviewerProposals.set_size(proposerPref.n_cols);
+        reviewerEngagements.set_size(proposerPref.n_rows);
+        nProposals = matchingR::galeShapleyExtremalMatchings(proposerPref, proposerRanks, reviewerPref, reviewerRanks,
+                                                             proposals.begin(), engagements.begin(),
+                                                             reviewerProposals.begin(), reviewerEngagements.begin());
+    });
+
+    // agents with the same partner in both extremal matchings
+    const uword N = engagements.n_elem;
+    const uword M = proposals.n_elem;
+    uvec uniqueProposers = find(proposals == reviewerProposals && proposals != N);
+    uvec uniqueReviewers = find(engagements == reviewerEngagements && engagements != M);
+
+    return List::create(
+      _["proposals"]            = proposals,
+      _["engagements"]          = engagements,
+      _["reviewer.proposals"]   = reviewerProposals,
+      _["reviewer.engagements"] = reviewerEngagements,
+      _["unique.proposers"]     = uniqueProposers,
+      _["unique.reviewers"]     = uniqueReviewers,
+      _["number.of.proposals"]  = nProposals);
+}
+
+//' Computes the rotations of a marriage market
+//'
+//' This function finds all rotations of a marriage market and the precedence
+//' relation between them. Users should not call this function directly and
+//' instead use \code{\link{galeShapley.rotations}}.
+//'
+//' @param proposerInput is a matrix with cardinal utilities or preference
+//'   orders of the proposing side of the market of dimension \code{m} by
+//'   \code{n}.
+//' @param reviewerInput is a matrix with cardinal utilities or preference
+//'   orders of the courted side of the market of dimension \code{n} by
+//'   \code{m}.
+//' @param proposerOrdinal is true if \code{proposerInput} contains preference
+//'   orders and false if it contains cardinal utilities.
+//' @param reviewerOrdinal is true if \code{reviewerInput} contains preference
+//'   orders and false if it contains cardinal utilities.
+//' @return A list with the following items:
+//'  \itemize{
+//'    \item{\code{rotations} is a list of matrices with two columns. Each row
+//'    of the \code{k}th matrix contains a proposer and the reviewer that he is
+//'    matched to before the \code{k}th rotation is eliminated (using C++
+//'    indexing). Afterwards, each proposer is matched to the reviewer in the
+//'    next row (the first row for the last proposer).}
+//'    \item{\code{predecessors} is a list whose \code{k}th element contains
+//'    the rotations that must be eliminated immediately before the \code{k}th
+//'    one (using C++ indexing).}
+//'  }
+//' @export
+// [[Rcpp::export]]
+List cpp_wrapper_galeshapley_rotations(SEXP proposerInput, SEXP reviewerInput, const bool proposerOrdinal, const bool reviewerOrdinal) {
+
+    matchingR::RotationPoset poset;
+
+    withMarket(proposerInput, reviewerInput, proposerOrdinal, reviewerOrdinal,
+               [&](const auto& proposerPref, const auto& proposerRanks, const auto& reviewerPref, const auto& reviewerRanks) {
+
+        uvec proposals, engagements;
+        buildLattice(proposerPref, proposerRanks, reviewerPref, reviewerRanks, proposals, engagements, poset);
+    });
+
+    List rotations(poset.size()), predecessors(poset.size());
+    for (uword rX = 0; rX < poset.size(); rX++) {
+        umat pairs(poset.ptr[rX + 1] - poset.ptr[rX], 2);
+        for (uword kX = poset.ptr[rX]; kX < poset.ptr[rX + 1]; kX++) {
+            pairs(kX - poset.ptr[rX], 0) = poset.proposers[kX];
+            pairs(kX - poset.ptr[rX], 1) = poset.reviewers[kX];
+        }
+        rotations[rX] = pairs;
+
+        uvec pred(poset.predPtr[rX + 1] - poset.predPtr[rX]);
+        for (uword kX = poset.predPtr[rX]; kX < poset.predPtr[rX + 1]; kX++) {
+            pred(kX - poset.predPtr[rX]) = poset.pred[kX];
+        }
+        predecessors[rX] = pred;
+    }
+
+    return List::create(
+      _["rotations"]    = rotations,
+      _["predecessors"] = predecessors);
+}
+
+//' Computes an egalitarian or a minimum regret stable matching
+//'
+//' This function computes the rotations of a marriage market and eliminates
+//' the set of rotations from the proposer-optimal matching that yields an
+//' egalitarian or a minimum regret stable matching. Users should not call this
+//' function directly and instead use \code{\link{galeShapley.egalitarian}} or
+//' \code{\link{galeShapley.minimumRegret}}.
+//'
+//' @param proposerInput is a matrix with cardinal utilities or preference
+//'   orders of the proposing side of the market of dimension \code{m} by
+//'   \code{n}.
+//' @param reviewerInput is a matrix with cardinal utilities or preference
+//'   orders of the courted side of the market of dimension \code{n} by
+//'   \code{m}.
+//' @param proposerOrdinal is true if \code{proposerInput} contains preference
+//'   orders and false if it contains cardinal utilities.
+//' @param reviewerOrdinal is true if \code{reviewerInput} contains preference
+//'   orders and false if it contains cardinal utilities.
+//' @param egalitarian is true for an egalitarian and false for a minimum
+//'   regret stable matching.
+//' @return  A list with the following items:
+//'  \itemize{
+//'    \item{\code{proposals} is a vector whose \code{i}th element contains the
+//'    reviewer that proposer \code{i} is matched to (using C++ indexing).
+//'    Unmatched proposers are listed as being matched to \code{m}.}
+//'    \item{\code{engagements} is a vector whose \code{j}th element contains
+//'    the proposer that reviewer \code{j} is matched to (using C++ indexing).
+//'    Unmatched reviewers are listed as being matched to \code{n}.}
+//'    \item{\code{cost} is the sum of the positions of all agents' partners in
+//'    their preferences (the most preferred partner is in position 1).}
+//'    \item{\code{regret} is the largest position of an agent's partner in its
+//'    preferences.}
+//'  }
+//' @export
+// [[Rcpp::export]]
+List cpp_wrapper_galeshapley_optimal(SEXP proposerInput, SEXP reviewerInput, const bool proposerOrdinal, const bool reviewerOrdinal, const bool egalitarian) {
+
+    uvec proposals, engagements;
+    uword cost = 0, regret = 0;
+
+    withMarket(proposerInput, reviewerInput, proposerOrdinal, reviewerOrdinal,
+               [&](const auto& proposerPref, const auto& proposerRanks, const auto& reviewerPref, const auto& reviewerRanks) {
+
+        matchingR::RotationPoset poset;
+        buildLattice(proposerPref, proposerRanks, reviewerPref, reviewerRanks, proposals, engagements, poset);
+
+        std::vector<char> eliminate;
+        if (egalitarian) {
+            matchingR::egalitarianRotations(poset, proposerRanks, reviewerRanks, eliminate);
+        } else {
+            matchingR::minimumRegretRotations(poset, proposerRanks, reviewerRanks, proposals.begin(), engagements.begin(), eliminate);
+        }
+        matchingR::eliminateRotations(poset, eliminate, proposals.begin(), engagements.begin());
+
+        const uword N = engagements.n_elem;
+        for (uword iX = 0; iX < proposals.n_elem; iX++) {
+            if (proposals(iX) != N) {
+                const uword proposerRank = proposerRanks(proposals(iX), iX) + 1;
+                const uword reviewerRank = reviewerRanks(iX, proposals(iX)) + 1;
+                cost += proposerRank + reviewerRank;
+                regret = std::max(regret, std::max(proposerRank, reviewerRank));
+            }
+        }
+    });
+
+    return List::create(
+      _["proposals"]   = proposals,
+      _["engagements"] = engagements,
+      _["cost"]        = cost,
+      _["regret"]      = regret);
+}
+
+// the state of an enumeration of all stable matchings
+struct StableMatchings {
+    matchingR::StableMatchingEnumerator enumerator;
+    uword M, N;
+};
+
+//' Starts an enumeration of all stable matchings
+//'
+//' This function computes the rotations of a marriage market and returns an
+//' external pointer to an enumerator, which produces one stable matching at a
+//' time (see \code{\link{cpp_wrapper_galeshapley_enumerator_next}}). Users
+//' should not call this function directly and instead use
+//' \code{\link{galeShapley.stableMatchings}}.
+//'
+//' @param proposerInput is a matrix with cardinal utilities or preference
+//'   orders of the proposing side of the market of dimension \code{m} by
+//'   \code{n}.
+//' @param reviewerInput is a matrix with cardinal utilities or preference
+//'   orders of the courted side of the market of dimension \code{n} by
+//'   \code{m}.
+//' @param proposerOrdinal is true if \code{proposerInput} contains preference
+//'   orders and false if it contains cardinal utilities.
+//' @param reviewerOrdinal is true if \code{reviewerInput} contains preference
+//'   orders and false if it contains cardinal utilities.
+//' @return An external pointer to the enumerator.
+//' @export
+// [[Rcpp::export]]
+SEXP cpp_wrapper_galeshapley_enumerator(SEXP proposerInput, SEXP reviewerInput, const bool proposerOrdinal, const bool reviewerOrdinal) {
+
+    StableMatchings* stream = NULL;
+
+    withMarket(proposerInput, reviewerInput, proposerOrdinal, reviewerOrdinal,
+               [&](const auto& proposerPref, const auto& proposerRanks, const auto& reviewerPref, const auto& reviewerRanks) {
+
+        uvec proposals, engagements;
+        matchingR::RotationPoset poset;
+        buildLattice(proposerPref, proposerRanks, reviewerPref, reviewerRanks, proposals, engagements, poset);
+
+        stream = new StableMatchings{
+            matchingR::StableMatchingEnumerator(poset, proposals.begin(), engagements.begin(), proposals.n_elem, engagements.n_elem),
+            proposals.n_elem, engagements.n_elem};
+    });
+
+    return XPtr<StableMatchings>(stream, true);
+}
+
+//' Returns the next stable matching of an enumeration
+//'
+//' Users should not call this function directly and instead use
+//' \code{\link{galeShapley.stableMatchings}}.
+//'
+//' @param enumerator is an external pointer that was returned by
+//'   \code{\link{cpp_wrapper_galeshapley_enumerator}}.
+//' @return A list with the elements \code{proposals} and \code{engagements}
+//'   as in \code{\link{cpp_wrapper_galeshapley_optimal}}, or \code{NULL} once
+//'   all stable matchings have been returned.
+//' @export
+// [[Rcpp::export]]
+SEXP cpp_wrapper_galeshapley_enumerator_next(SEXP enumerator) {
+
+    XPtr<StableMatchings> stream(enumerator);
+
+    uvec proposals(stream->M), engagements(stream->N);
+    if (!stream->enumerator.next(proposals.begin(), engagements.begin())) {
+        return R_NilValue;
+    }
+
+    return List::create(
+      _["proposals"]   = proposals,
+      _["engagements"] = engagements);
+}
@@ -0,0 +1,34 @@
+//  matchingR -- Matching Algorithms in R and C++
+//
+//  Copyright (C) 2015  Jan Tilly <jtilly@econ.upenn.edu>
+//                      Nick Janetos <njanetos@econ.upenn.edu>
+//
+//  This file is part of matchingR.
+//
+//  matchingR is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation, either version 2 of the License, or
+//  (at your option) any later version.
+//
+//  matchingR is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+
+#ifndef lattice_h
+#define lattice_h
+
+#include "matchingR.h"
+#include "utils.h"
+#include <matchingR/lattice.h>
+
+template <typename ProposerInput, typename ReviewerInput, typename Index>
+void readMarket(const ProposerInput& proposerInput, const ReviewerInput& reviewerInput, const bool proposerOrdinal, const bool reviewerOrdinal,
+                Mat<Index>& proposerPref, Mat<Index>& proposerRanks, Mat<Index>& reviewerPref, Mat<Index>& reviewerRanks);
+List cpp_wrapper_galeshapley_extremal(SEXP proposerInput, SEXP reviewerInput, const bool proposerOrdinal, const bool reviewerOrdinal);
+List cpp_wrapper_galeshapley_rotations(SEXP proposerInput, SEXP reviewerInput, const bool proposerOrdinal, const bool reviewerOrdinal);
+List cpp_wrapper_galeshapley_optimal(SEXP proposerInput, SEXP reviewerInput, const bool proposerOrdinal, const bool reviewerOrdinal, const bool egalitarian);
+SEXP cpp_wrapper_galeshapley_enumerator(SEXP proposerInput, SEXP reviewerInput, const bool proposerOrdinal, const bool reviewerOrdinal);
+SEXP cpp_wrapper_galeshapley_enumerator_next(SEXP enumerator);
+
+#endif
@@ -19,6 +19,56 @@
 
 // [[Rcpp::depends(RcppArmadillo)]]
 
+// Computes a stable matching for preference lists in compressed sparse row
+// format (see cpp_wrapper_irving_sparse). Ptr and Idx can be uvecs, views of
+// a preference file, or, with ColumnOffsets, the columns of a dense preference
+// matrix.
+template <typename Ptr, typename Idx>
+SEXP irvingSparse(const Ptr& ptr, const Idx& idx, const char* error) {
+
+    if (ptr.n_elem == 0 || ptr(ptr.n_elem - 1) != idx.n_elem) {
+        stop(error);
+    }
+
+    // the tables hold positions within the lists and individuals up to N + 1
+    const uword N = ptr.n_elem - 1;
+    return withIndexType(N + 1, [&](auto index) {
+        typedef decltype(index) Index;
+        uvec matchings(N);
+        matchingR::IrvingSparseScratch<Index> scratch;
+        if (!matchingR::roommateMirror(ptr, idx, scratch)) {
+            stop(error);
+        }
+        scratch.statistics.phase("preprocessing");
+        matchingR::irvingMatchingSparse(ptr, idx, matchings.begin(), scratch);
+        return addStatistics(matchings, scratch.statistics);
+    });
+}
+
+// Computes a stable matching for a dense N-1 by N preference matrix (see
+// cpp_wrapper_irving). If N is odd, someone has to stay unmatched and the
+// columns are read in place as incomplete preference lists.
+template <typename Pref>
+SEXP irvingDense(const Pref& pref) {
+
+    if (pref.n_cols % 2 == 1) {
+        return irvingSparse(matchingR::ColumnOffsets(pref.n_rows, pref.n_cols), pref,
+                            "Invalid preference matrix: Incomplete preferences.");
+    }
+
+    return withIndexType(pref.n_cols + 1, [&](auto index) {
+        typedef decltype(index) Index;
+        uvec matchings(pref.n_cols);
+        matchingR::IrvingScratch<Index> scratch;
+        if (!matchingR::roommateRanks(pref, scratch.rank)) {
+            stop("Invalid preference matrix: Incomplete preferences.");
+        }
+        scratch.statistics.phase("preprocessing");
+        matchingR::irvingMatching(pref, matchings.begin(), scratch);
+        return addStatistics(matchings, scratch.statistics);
+    });
+}
+
 //' Computes a stable roommate matching
 //'
 //' This is the C++ wrapper for the stable roommate problem. Users should not
@@ -30,201 +80,247 @@
 //'   dimension \code{n-1} by \code{n}. The \code{i,j}th element refers to
 //'   \code{j}'s \code{i}th most favorite partner. Preference orders must be
 //'   specified using C++ indexing (starting at 0). The matrix \code{pref} must
-//'   be of dimension \code{n-1} by \code{n}.
+//'   be of dimension \code{n-1} by \code{n}. If \code{n} is odd, the columns
+//'   are read in place as preference lists of Irving's algorithm for
+//'   incomplete lists (see \code{\link{cpp_wrapper_irving_sparse}}), so that
+//'   one individual stays unmatched.
 //' @return A vector of length \code{n} corresponding to the matchings that were
 //'   formed (using C++ indexing). E.g. if the \code{4}th element of this vector
 //'   is \code{0} then individual \code{4} was matched with individual \code{1}.
-//'   If no stable matching exists, then this function returns a vector of
-//'   zeros.
+//'   Individuals that are matched to \code{n} are unmatched. If no stable
+//'   matching exists, then this function returns a vector of zeros. If the
+//'   package was compiled with \code{MATCHINGR_STATISTICS} defined, the vector
+//'   has an attribute \code{statistics}, which is a list with the numbers of
+//'   proposals and rejections in phase 1, the number of rotations that were
+//'   eliminated in phase 2, and the wall time of the preprocessing and of both
+//'   phases in seconds.
 //'  @export
 // [[Rcpp::export]]
-uvec cpp_wrapper_irving(const umat pref) {
+SEXP cpp_wrapper_irving(SEXP pref) {
+    return withMatrixView(pref, [&](const auto& prefView) {
+        return irvingDense(prefView);
+    });
+}
 
-    // Number of participants
-    uword N = pref.n_cols;
-
-    uvec proposal_to(N);
-    uvec proposal_from(N);
-    uvec proposed_to(N);
-
-    // All participants begin unmatched having proposals accepted by nobody (=N)...
-    proposal_to.fill(N);
-    // having accepted proposals from nobody (=N)...
-    proposal_from.fill(N);
-    // and having proposed to nobody.
-    proposed_to.zeros();
-
-    // Empty matchings
-    uvec matchings(N);
-
-    bool stable = false;
-    while (!stable) {
-        // set stable to false later if anyone hasn't proposed / been proposed to
-        stable = true;
-        for (uword n = 0; n < N; n++) {
-            // n proposes to the next best guy if he hasn't proposed to everyone already...
-            if (proposed_to(n) >= N-1) { return matchings.zeros(); }
+//' Computes a stable roommate matching with incomplete preference lists
+//'
+//' This is the C++ wrapper for the stable roommate problem when individuals
+//' only list some of the others (Irving's algorithm for incomplete lists, see
+//' Gusfield and Irving, 1989, Section 4.5.2). Two individuals can only be
+//' matched if each of them lists the other, and some individuals may stay
+//' unmatched. Preferences are stored in compressed sparse row (CSR) format:
+//' the preference list of individual \code{i} is given by the elements
+//' \code{ptr[i]} to \code{ptr[i+1]-1} of \code{idx}. Memory and the running
+//' time of phase 1 are proportional to the number of listed pairs. Users should
+//' not call this function directly, but instead use \code{\link{roommate}}.
+//'
+//' @param ptr is a vector of length \code{n+1} with the offsets of the
+//'   individuals' preference lists in \code{idx}.
+//' @param idx is a vector with the concatenated preference lists of the
+//'   individuals (using C++ indexing), each ordered from the most to the least
+//'   preferred partner.
+//' @return A vector of length \code{n} corresponding to the matchings that were
+//'   formed (using C++ indexing). Individuals that are matched to \code{n} are
+//'   unmatched. If no stable matching exists, then this function returns a
+//'   vector of zeros. If the package was compiled with
+//'   \code{MATCHINGR_STATISTICS} defined, the vector has an attribute
+//'   \code{statistics} as in \code{\link{cpp_wrapper_irving}}.
+//'  @export
+// [[Rcpp::export]]
+SEXP cpp_wrapper_irving_sparse(const uvec& ptr, const uvec& idx) {
+    return irvingSparse(ptr, idx, "Invalid preference lists: lists must refer to other individuals that exist and must not contain duplicates.");
+}
 
-            // or if he has no proposals accepted by anyone.
-            if (proposal_to(n) == N) {
+//' Computes a stable roommate matching from a preference file
+//'
+//' This function computes a stable roommate matching for preferences that are
+//' stored in a preference file (see \code{\link{preferenceFile.write}}). The
+//' file is mapped into memory and read in place. If the number of individuals
+//' is odd, one of them stays unmatched, as in \code{\link{roommate}}. Users
+//' should not call this function directly and instead use
+//' \code{\link{roommate}}.
+//'
+//' @param file is the path of a file with a dense \code{n-1} by \code{n}
+//'   matrix of preference orders or with \code{n} truncated preference lists
+//'   (see \code{\link{cpp_wrapper_irving_sparse}}).
+//' @return A vector of length \code{n} corresponding to the matchings that were
+//'   formed (using C++ indexing) as in \code{\link{cpp_wrapper_irving}}.
+//'   Individuals that are matched to \code{n} are unmatched. If no stable
+//'   matching exists, then this function returns a vector of zeros.
+//'  @export
+// [[Rcpp::export]]
+SEXP cpp_wrapper_irving_file(const std::string& file) {
 
-                // find the player he is proposing to next
-                uword proposee = pref(proposed_to(n), n);
+    const matchingR::PreferenceFile prefFile(file);
+    const matchingR::PreferenceFileHeader& head = prefFile.header();
+    if (head.content != matchingR::PREFERENCE_ORDERS) {
+        stop("The preference file must contain preference orders.");
+    }
 
-                // proposee's preferences
-                const uvec prop_call = pref.col(proposee);
+    if (head.layout == matchingR::CSR) {
+        if (head.n_rows != head.n_cols) {
+            stop("The preference lists of a roommate problem must refer to the same individuals that have lists.");
+        }
+        return matchingR::withCSRView(prefFile, [&](const auto& ptr, const auto& idx) {
+            return irvingSparse(ptr, idx, "Invalid preference lists: lists must refer to other individuals that exist and must not contain duplicates.");
+        });
+    }
 
-                // find proposee's opinion of the proposer (lower is better)
-                uword op = N;
-                for (uword i = 0; i < prop_call.n_elem; i++) {
-                    if (prop_call(i) == n) {
-                        op = i;
-                        break;
-                    }
-                }
+    if (head.n_rows + 1 != head.n_cols) {
+        stop("preference matrix must be n-1xn");
+    }
 
-                if (op == N) { stop("Invalid preference matrix: Incomplete preferences."); }
-
-                // find proposee's opinion of his current match
-                // lower is better
-                // unmmatched is N
-                uword op_curr = N;
-                for (uword i = 0; i < prop_call.n_elem; i++) {
-                    if (prop_call(i) == proposal_from(proposee)) {
-                        op_curr = i;
-                        break;
-                    }
-                }
+    return matchingR::withDenseView(prefFile, [&](const auto& pref) {
+        return irvingDense(pref);
+    });
+}
 
-                // if the next best guy likes him he accepts
-                if (op < op_curr) {
-
-                    // make the proposal
-                    proposal_to(n) = proposee;
-                    // reject the proposee's original proposer's proposal
-                    // got it!?
-                    if (proposal_from(proposee) != N) {
-                        proposal_to(proposal_from(proposee)) = N;
-                        // someone has proposed to nobody, we're not stabler yet
-                        stable = false;
-                    }
-                    // record the proposal
-                    proposal_from(proposee) = n;
-                } else {
-                    // offer was rejected, we're not stable yet
-                    stable = false;
-                }
+//' Computes stable roommate matchings for many markets
+//'
+//' This function computes the Irving (1985) algorithm for many independent
+//' markets of the same size. The markets are solved in parallel, and each
+//' thread reuses its tables across the markets that it solves. If the number
+//' of individuals is odd, one individual in each market stays unmatched, as
+//' in \code{\link{roommate}}. Users should not call this function directly
+//' and instead use \code{\link{roommate.batch}}.
+//'
+//' @param utils is an array with cardinal utilities for each individual in
+//'   each market. If there are \code{n} individuals and \code{k} markets, then
+//'   this array will be of dimension \code{n-1} by \code{n} by \code{k}.
+//'   Column \code{j} of slice \code{l} refers to the payoff that individual
+//'   \code{j} receives from being matched to individual \code{1, 2, ..., j-1,
+//'   j+1, ...n} in market \code{l}.
+//' @return A list with the following items:
+//'  \itemize{
+//'    \item{\code{matchings} is a matrix of dimension \code{n} by \code{k}
+//'    whose \code{l}th column contains the matching of market \code{l} (using
+//'    C++ indexing). Individuals that remain unmatched are listed as being
+//'    matched to \code{n}.}
+//'    \item{\code{stable} is a vector of length \code{k} that is zero for
+//'    markets in which no stable matching exists and one otherwise.}
+//'  }
+//'  @export
+// [[Rcpp::export]]
+List cpp_wrapper_irving_batch(const cube& utils) {
 
-                // iterate n's proposal forward
-                proposed_to(n)++;
-            }
-        }
-    }
+    // number of individuals and markets
+    const uword N = utils.n_cols;
+    const uword K = utils.n_slices;
 
-    // Generate tables, initially of length N
-    std::vector< std::deque<uword> > table(N, std::deque<uword>(N-1));
-    for (uword n = 0; n < N; ++n) {
-        for (uword i=0; i<N-1; i++) {
-            // fill in the table with preferences
-            table[n][i] = pref(i, n);
-        }
+    if (utils.n_rows + 1 != N) {
+        stop("utils must be of dimension n-1 by n by k.");
+    }
+    if (utils.has_nan()) {
+        stop("utils must not contain missing values.");
     }
 
-    // Delete entries we eliminated in round 1
-    for (uword n = 0; n < N; n++) {
-        for (int i = table[n].size()-1; i>= 0; i--) {
-            if (table[n][i] == proposal_from(n)) {
-                break;
-            } else {
-                if (table[n].size() == 0) { return matchings.zeros(); }
-                // find and erase from the table
-                bool erased = false;
-                for (uword j = 0; j < table[table[n].back()].size(); j++) {
-                    if (table[table[n].back()][j] == n) {
-                        table[table[n].back()].erase(table[table[n].back()].begin() + j);
-                        erased = true;
-                        break;
-                    }
+    // when N is odd, someone has to stay unmatched and the preferences are
+    // read as incomplete preference lists
+    const bool odd = N % 2 == 1;
+    const matchingR::ColumnOffsets ptr(N - 1, N);
+
+    umat matchings(N, K);
+    uvec stable(K);
+
+    // the tables hold indices up to N + 1 (positions within the lists for
+    // incomplete lists)
+    withIndexType(N + 1, [&](auto index) {
+        typedef decltype(index) Index;
+        #pragma omp parallel
+        {
+            // buffers of this thread
+            matchingR::IrvingScratch<Index> scratch;
+            matchingR::IrvingSparseScratch<Index> sparseScratch;
+            Mat<Index> pref;
+            uvec matchingsX(N);
+
+            #pragma omp for schedule(dynamic)
+            for (uword kX = 0; kX < K; kX++) {
+                pref = sortPreferences<Index>(utils.slice(kX), N - 1, true);
+                if (odd) {
+                    matchingR::roommateMirror(ptr, pref, sparseScratch);
+                    stable(kX) = matchingR::irvingMatchingSparse(ptr, pref, matchingsX.begin(), sparseScratch);
+                } else {
+                    matchingR::roommateRanks(pref, scratch.rank);
+                    stable(kX) = matchingR::irvingMatching(pref, matchingsX.begin(), scratch);
+                }
+                for (uword n = 0; n < N; n++) {
+                    matchings(n, kX) = stable(kX) ? matchingsX(n) : N;
                 }
-                if (!erased) { return matchings.zeros(); }
-                table[n].pop_back();
             }
         }
-    }
+    });
 
-    // Eliminate rotations
-    // A 'rotation' is a series of individuals and preference pairs which satisfy
-    // a relationship specified in Irving (1985). Removing a rotation maintains the
-    // status of the table as a 'stable' table, meaning everyone's most preferred
-    // feasible option hates them.
-    stable = false;
-    while(!stable) {
-        stable = true;
-        for (uword n = 0; n < N; n++) {
-            if (table[n].size() > 1) {
-                stable = false;
-                std::vector<uword> x;
-                std::vector<uword> index;
+    return List::create(
+      _["matchings"] = matchings,
+      _["stable"] = stable);
+}
 
-                uword new_index = n;
-                // Unassigned for now, so assign to the maximum value
-                uword rot_tail = static_cast<uword>(-1);
+// Finds all pairs of individuals who would rather be matched to each other
+// than to their assigned partners. Individuals that are matched to N (or
+// above) are unmatched and prefer anyone to being unmatched. Each pair is
+// listed once, with the first individual ahead of the second.
+template <typename Pref>
+umat blockingPairsRoommate(const Pref& pref, const umat& matchings) {
 
-                while (rot_tail == (uword) (index.end() - index.begin() - 1)) {
-                    int new_x = table[new_index][1];
-                    new_index = table[new_x].back();
+    // Number of participants
+    const uword N = pref.n_cols;
 
-                    // Check for a rotation
-                    rot_tail = find(index.begin(), index.end(), new_index) - index.begin();
+    if (matchings.n_elem != N) {
+        stop("matchings must have as many elements as there are individuals.");
+    }
 
-                    x.push_back(new_x);
-                    index.push_back(new_index);
-                }
+    return withIndexType(N, [&](auto index) {
+        typedef decltype(index) Index;
 
-                // Delete the rotation
-                for (uword i = rot_tail + 1; i < index.size(); i++) {
-                    while(table[x[i]].back() != index[i-1]) {
-                        // find and erase from the table
-                        // x[i] needs to be removed from  table[table[x[i]].back()], and
-                        // table[table[x[i]].back()][x[i]] needs to be removed from
-                        // table[x[i]].
-                        uword tab_size = table[table[x[i]].back()].size();
-
-                        // Remove x[i] from table[table[x[i]].back()]
-                        // If x[i] is not in table[table[x[i]].back()], then it should remove
-                        // nothing.
-                        // This uses an 'erase-remove' idiom from the std library.
-                        table[table[x[i]].back()].erase(std::remove(table[table[x[i]].back()].begin(),
-                                                        table[table[x[i]].back()].end(),
-                                                        x[i]),
-                                                        table[table[x[i]].back()].end());
-
-                        // Check to see if it removed x[i] or not (whether the table's the same size)
-                        if (tab_size == table[table[x[i]].back()].size()) { return matchings.zeros(); }
-
-                        // Check to see if there's only one element remaining (if so, no stable matching.)
-                        if (table[x[i]].size() == 1) { return matchings.zeros(); }
-
-                        // Remove table[table[x[i]].back()][x[i]] from table[x[i]] (it should be at the end).
-                        table[x[i]].pop_back();
-                    }
-                }
+        // rank(j, n) is the position of j in n's preferences (lower is
+        // better), or N if n does not rank j
+        matchingR::Matrix<Index> rank;
+        if (!matchingR::roommateRanks(pref, rank)) {
+            stop("Invalid preference matrix: Incomplete preferences.");
+        }
+
+        // rank of each individual's partner (N if unmatched)
+        uvec partnerRank(N);
+        for (uword n = 0; n < N; n++) {
+            partnerRank(n) = matchings(n) < N ? rank(matchings(n), n) : N;
+        }
+
+        // only individuals that n ranks above his partner can form a blocking
+        // pair with n
+        uvec counts(N);
+        #pragma omp parallel for schedule(dynamic)
+        for (uword n = 0; n < N; n++) {
+            uword count = 0;
+            for (uword i = 0; i < std::min(partnerRank(n), (uword) pref.n_rows); i++) {
+                const uword m = pref(i, n);
+                count += n < m && rank(n, m) < partnerRank(m);
             }
+            counts(n) = count;
         }
-    }
 
-    // Check if anything is empty
-    for (uword i = 0; i < table.size(); i++) {
-        if (table[i].empty()) { return matchings.zeros(); }
-    }
+        uvec offsets(N + 1);
+        offsets(0) = 0;
+        for (uword n = 0; n < N; n++) {
+            offsets(n + 1) = offsets(n) + counts(n);
+        }
 
-    // Create the matchings
-    matchings.resize(N);
-    for (uword n = 0; n < N; n++) {
-        matchings[n] = table[n][0];
-    }
+        umat blockingPairs(offsets(N), 2);
+        #pragma omp parallel for schedule(dynamic)
+        for (uword n = 0; n < N; n++) {
+            uword row = offsets(n);
+            for (uword i = 0; row < offsets(n + 1); i++) {
+                const uword m = pref(i, n);
+                if (n < m && rank(n, m) < partnerRank(m)) {
+                    blockingPairs(row, 0) = n;
+                    blockingPairs(row, 1) = m;
+                    row++;
+                }
+            }
+        }
 
-    return matchings;
+        return blockingPairs;
+    });
 }
 
 //' Check if a matching solves the stable roommate problem
@@ -242,39 +338,49 @@ uvec cpp_wrapper_irving(const umat pref) {
 //' @param matchings is a vector of length \code{n} corresponding to the
 //'   matchings that were formed (using C++ indexing). E.g. if the \code{4}th
 //'   element of this vector is \code{0} then individual \code{4} was matched
-//'   with individual \code{1}. If no stable matching exists, then this function
-//'   returns a vector of zeros.
+//'   with individual \code{1}. Individuals that are matched to \code{n} are
+//'   unmatched.
 //' @return true if the matching is stable, false otherwise
 //'  @export
 // [[Rcpp::export]]
-bool cpp_wrapper_irving_check_stability(umat& pref, umat& matchings) {
-
-    // loop through everyone and check whether there's anyone else
-    // who they'd rather be with
-    for (uword i=0; i<pref.n_cols; i++) {
-        for (uword j=i+1; j<pref.n_cols; j++) {
-
-            // do i, j prefer to switch?
-            bool i_prefers = false;
-            bool j_prefers = false;
-
-            // i?
-            for (uword k=0; k<pref.n_rows; k++) {
-                if (pref(k, i) == j) i_prefers = true;
-                if (pref(k, i) == matchings(i)) break;
-            }
-
-            // j?
-            for (uword k=0; k<pref.n_rows; k++) {
-                if (pref(k, j) == j) j_prefers = true;
-                if (pref(k, j) == matchings(j)) break;
-            }
+bool cpp_wrapper_irving_check_stability(SEXP pref, const umat& matchings) {
+    return withMatrixView(pref, [&](const auto& prefView) {
+        return blockingPairsRoommate(prefView, matchings).n_rows == 0;
+    });
+}
 
-            // do they both want to switch?
-            if (i_prefers && j_prefers) { return false; }
-        }
-    }
+//' Compute the blocking pairs of a roommate matching
+//'
+//' This function finds all pairs of individuals who would rather be matched
+//' with each other than with their assigned partners. It builds a table with
+//' the rank of every individual in everyone else's preferences once, so that
+//' each pair can be checked in constant time. Individuals are checked in
+//' parallel. Users should not call this function directly and instead use
+//' \code{\link{roommate.blockingPairs}}.
+//'
+//' @param pref is a matrix with the preference order of each individual in the
+//'   market. If there are \code{n} individuals, then this matrix will be of
+//'   dimension \code{n-1} by \code{n}. The \code{i,j}th element refers to
+//'   \code{j}'s \code{i}th most favorite partner. Preference orders must be
+//'   specified using C++ indexing (starting at 0).
+//' @param matchings is a vector of length \code{n} corresponding to the
+//'   matchings that were formed (using C++ indexing). Individuals that are
+//'   matched to \code{n} are unmatched.
+//' @return A list with the following items:
+//'  \itemize{
+//'    \item{\code{blocking.pairs} is a matrix with two columns. Each row
+//'    contains two individuals that form a blocking pair (using C++ indexing).}
+//'    \item{\code{number.of.blocking.pairs} is the number of blocking pairs.}
+//'  }
+//'  @export
+// [[Rcpp::export]]
+List cpp_wrapper_irving_blocking_pairs(SEXP pref, const umat& matchings) {
 
-    return true;
+    const umat blockingPairs = withMatrixView(pref, [&](const auto& prefView) {
+        return blockingPairsRoommate(prefView, matchings);
+    });
 
+    return List::create(
+      _["blocking.pairs"] = blockingPairs,
+      _["number.of.blocking.pairs"] = blockingPairs.n_rows);
 }
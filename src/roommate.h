@@ -18,10 +18,21 @@
 #ifndef roommate_h
 #define roommate_h
 
-#include <deque>
 #include "matchingR.h"
+#include "utils.h"
+#include <matchingR/roommate.h>
 
-uvec cpp_wrapper_irving(const umat pref);
-bool cpp_wrapper_irving_check_stability(umat pref, umat matchings);
+template <typename Ptr, typename Idx>
+SEXP irvingSparse(const Ptr& ptr, const Idx& idx, const char* error);
+template <typename Pref>
+SEXP irvingDense(const Pref& pref);
+SEXP cpp_wrapper_irving(SEXP pref);
+SEXP cpp_wrapper_irving_sparse(const uvec& ptr, const uvec& idx);
+SEXP cpp_wrapper_irving_file(const std::string& file);
+List cpp_wrapper_irving_batch(const cube& utils);
+bool cpp_wrapper_irving_check_stability(SEXP pref, const umat& matchings);
+List cpp_wrapper_irving_blocking_pairs(SEXP pref, const umat& matchings);
+template <typename Pref>
+umat blockingPairsRoommate(const Pref& pref, const umat& matchings);
 
 #endif
@@ -39,111 +39,270 @@
 //' @return A vector of length \code{n} corresponding to the matchings being
 //'   made, so that e.g. if the \code{4}th element is \code{5} then agent
 //'   \code{4} was matched to agent \code{6}. This vector uses C++ indexing that
-//'   starts at 0.
+//'   starts at 0. If the package was compiled with
+//'   \code{MATCHINGR_STATISTICS} defined, the vector has an attribute
+//'   \code{statistics}, which is a list with the lengths of the cycles in the
+//'   order in which they were found and the wall time of the algorithm in
+//'   seconds.
 //' @export
 // [[Rcpp::export]]
-uvec cpp_wrapper_ttc(const umat pref) {
+SEXP cpp_wrapper_ttc(SEXP pref) {
+    return withMatrixView(pref, [&](const auto& prefView) {
+        return withIndexType(prefView.n_cols, [&](auto index) {
+            typedef decltype(index) Index;
+            uvec matchings(prefView.n_cols);
+            matchingR::TTCScratch<Index> scratch;
+            if (!matchingR::ttcMatching(prefView, matchings.begin(), scratch)) {
+                stop("Invalid preference matrix: Incomplete preferences.");
+            }
+            scratch.statistics.phase("matching");
+            return addStatistics(matchings, scratch.statistics);
+        });
+    });
+}
 
-    // maximum value of uword
-    uword NULL_VAL = static_cast<uword>(-1);
+//' Computes the top trading cycle algorithm from a preference file
+//'
+//' This function computes the top trading cycle algorithm for preferences that
+//' are stored in a preference file (see \code{\link{preferenceFile.write}}).
+//' The file is mapped into memory and read in place. Users should not call this
+//' function directly and instead use \code{\link{toptrading}}.
+//'
+//' @param file is the path of a file with a dense \code{n} by \code{n}
+//'   matrix of preference orders.
+//' @return A vector of length \code{n} corresponding to the matchings being
+//'   made (using C++ indexing).
+//' @export
+// [[Rcpp::export]]
+uvec cpp_wrapper_ttc_file(const std::string& file) {
 
-    // the number of participants
-    uword N = pref.n_cols;
+    const matchingR::PreferenceFile prefFile(file);
+    if (prefFile.header().layout != matchingR::DENSE || prefFile.header().content != matchingR::PREFERENCE_ORDERS) {
+        stop("The preference file must contain a dense matrix of preference orders.");
+    }
 
+    return matchingR::withDenseView(prefFile, [&](const auto& pref) {
+        const uword N = pref.n_cols;
+        if (pref.n_rows != N) {
+            stop("preference matrix must be nxn");
+        }
+        if (!indicesBelow(pref, N)) {
+            stop("Invalid preference matrix: preferences refer to an agent that does not exist.");
+        }
+        return withIndexType(N, [&](auto index) {
+            typedef decltype(index) Index;
+            uvec matchings(N);
+            matchingR::TTCScratch<Index> scratch;
+            if (!matchingR::ttcMatching(pref, matchings.begin(), scratch)) {
+                stop("Invalid preference matrix: Incomplete preferences.");
+            }
+            return matchings;
+        });
+    });
+}
 
-    // a vector of zeros and ones, encodes whether a
-    // participant has been matched or not
-    // everyone begins unmatched.
-    uvec is_matched(N);
-    is_matched.zeros();
+//' Computes the top trading cycle algorithm for many markets
+//'
+//' This function computes the top trading cycle algorithm for many independent
+//' markets of the same size. The markets are solved in parallel, and each
+//' thread reuses its buffers across the markets that it solves. Users should
+//' not call this function directly and instead use
+//' \code{\link{toptrading.batch}}.
+//'
+//' @param utils is an array with cardinal utilities for each individual in
+//'   each market. If there are \code{n} individuals and \code{k} markets, then
+//'   this array will be of dimension \code{n} by \code{n} by \code{k}. The
+//'   \code{i,j,l}th element refers to the payoff that individual \code{j}
+//'   receives from being matched to individual \code{i} in market \code{l}.
+//' @return A matrix of dimension \code{n} by \code{k} whose \code{l}th column
+//'   contains the matchings of market \code{l} (using C++ indexing).
+//' @export
+// [[Rcpp::export]]
+umat cpp_wrapper_ttc_batch(const cube& utils) {
 
-    // the vector of matchings to be returned
-    uvec matchings(N);
-    matchings.fill(NULL_VAL);
+    // number of individuals and markets
+    const uword N = utils.n_cols;
+    const uword K = utils.n_slices;
 
-    // used for the algorithm below
-    uword current_agent = NULL_VAL;
+    if (utils.n_rows != N) {
+        stop("utils must be of dimension n by n by k.");
+    }
+    if (utils.has_nan()) {
+        stop("utils must not contain missing values.");
+    }
 
+    umat matchings(N, K);
 
-    // loop until everyone's been matched
-    while (true) {
+    withIndexType(N, [&](auto index) {
+        typedef decltype(index) Index;
+        #pragma omp parallel
+        {
+            // buffers of this thread
+            matchingR::TTCScratch<Index> scratch;
+            Mat<Index> pref;
 
-        // if current_agent = -1, then set current_agent to be the first unmatched guy
-        if (current_agent == NULL_VAL) {
-            // find the first unmatched guy
-            current_agent = as_scalar(find(is_matched == 0, 1));
+            #pragma omp for schedule(dynamic)
+            for (uword kX = 0; kX < K; kX++) {
+                pref = sortPreferences<Index>(utils.slice(kX), N, false);
+                matchingR::ttcMatching(pref, matchings.colptr(kX), scratch);
+            }
         }
+    });
 
+    return matchings;
+}
 
-        // now identify rotations
-        while(true) {
-            // start cycling through preferences, starting with current_agent
+// Finds a coalition of agents who can all do at least as well, and at least
+// one of them strictly better, by trading their houses among themselves. The
+// agents are returned in the order of the trades, i.e. each agent would receive
+// the house of the next agent and the last agent would receive the house of the
+// first one. The coalition is empty if the matching is in the core.
+//
+// Agent i weakly prefers the house of agent j to his own allocation if j comes
+// no later than matchings(i) in i's preferences, so i's edges in this
+// "improving-trade" graph are a prefix of i's preferences. A blocking
+// coalition exists if and only if some edge to a strictly preferred house
+// lies in a strongly connected component of this graph.
+template <typename Pref>
+uvec blockingCoalitionTTC(const Pref& pref, const uvec& matchings) {
 
-            // find current_agent's most preferred, unmatched outcome, p
-            // provisionally match current_agent to p by setting matchings[current_agent] = p
-            for (uword i = 0; i < N; ++i) {
-            if (is_matched(pref(i, current_agent)) == 0) {
-                    matchings(current_agent) = pref(i, current_agent);
-                    break;
-                }
-            }
+    // the number of participants
+    const uword N = pref.n_cols;
 
-            // check if p has already shown up in this chain by checking if
-            // matchings[p] is larger than -1. if it is larger than -1, then
-            // that agent, who we know is unmatched, must already have shown up
-            // somewhere in this loop. if matchings[p] is equal to -1, then that agent
-            // has never shown up in a loop and we can continue
+    // maximum value of uword
+    const uword NULL_VAL = static_cast<uword>(-1);
+
+    if (matchings.n_elem != N) {
+        stop("matchings must have as many elements as there are agents.");
+    }
+    if (!indicesBelow(pref, N)) {
+        stop("Invalid preference matrix: preferences refer to an agent that does not exist.");
+    }
 
-            // if matchings is larger than -1, then we have a rotation, starting
-            // with p, and ending with current_agent, so break
-            if (matchings(matchings(current_agent)) != NULL_VAL) {
+    // rank of each agent's allocation in his own preferences
+    uvec partner_rank(N);
+    #pragma omp parallel for schedule(static)
+    for (uword i = 0; i < N; i++) {
+        partner_rank(i) = NULL_VAL;
+        for (uword k = 0; k < pref.n_rows; k++) {
+            if (pref(k, i) == matchings(i)) {
+                partner_rank(i) = k;
                 break;
             }
-
-            // otherwise, continue looking for a rotation by setting current_agent to the next guy
-            current_agent = matchings(current_agent);
         }
+    }
+    for (uword i = 0; i < N; i++) {
+        if (partner_rank(i) == NULL_VAL) {
+            stop("Invalid matchings: agents must be matched to an agent from their preferences.");
+        }
+    }
 
-        // loop through, starting with p, then matchings[p], etc., and
-        // ending with current_agent. for each agent, set is_matched to
-        // 1.
-        for (uword i = matchings(current_agent); i != current_agent; i = matchings(i)) {
-            is_matched(i) = 1;
+    // strongly connected components of the weak improvement graph (Tarjan's
+    // algorithm with an explicit stack instead of recursion)
+    uvec index(N), low(N), component(N), next_edge(N), on_stack(N);
+    index.fill(NULL_VAL);
+    on_stack.zeros();
+    std::vector<uword> stack, call_stack;
+    uword counter = 0, n_components = 0;
+
+    for (uword root = 0; root < N; root++) {
+        if (index(root) != NULL_VAL) continue;
+
+        index(root) = low(root) = counter++;
+        next_edge(root) = 0;
+        stack.push_back(root);
+        on_stack(root) = 1;
+        call_stack.push_back(root);
+
+        while (!call_stack.empty()) {
+            const uword v = call_stack.back();
+            if (next_edge(v) <= partner_rank(v)) {
+                const uword w = pref(next_edge(v)++, v);
+                if (index(w) == NULL_VAL) {
+                    index(w) = low(w) = counter++;
+                    next_edge(w) = 0;
+                    stack.push_back(w);
+                    on_stack(w) = 1;
+                    call_stack.push_back(w);
+                } else if (on_stack(w)) {
+                    low(v) = std::min(low(v), index(w));
+                }
+            } else {
+                call_stack.pop_back();
+                if (!call_stack.empty()) {
+                    low(call_stack.back()) = std::min(low(call_stack.back()), low(v));
+                }
+                if (low(v) == index(v)) {
+                    uword w;
+                    do {
+                        w = stack.back();
+                        stack.pop_back();
+                        on_stack(w) = 0;
+                        component(w) = n_components;
+                    } while (w != v);
+                    n_components++;
+                }
+            }
         }
-        is_matched(current_agent) = 1;
+    }
 
-        for (uword i = 0; i < N; i++) {
+    // look for an edge to a strictly preferred house within a component
+    uvec strict_edge(N);
+    #pragma omp parallel for schedule(dynamic)
+    for (uword i = 0; i < N; i++) {
+        strict_edge(i) = NULL_VAL;
+        for (uword k = 0; k < partner_rank(i); k++) {
+            if (component(pref(k, i)) == component(i)) {
+                strict_edge(i) = k;
+                break;
+            }
         }
+    }
 
-        // check if everyone's matched, if so, we're done, so break
-        if (sum(is_matched) == N) break;
-
-        // otherwise, we need to set current_agent in such a way so as to continue
-        // looking for rotations
-
-        // one way to do this would be to check if (1-is_matched) .* matchings = -1*sum(1-is_matched)
-        // if true, then set current_agent equal to -1 to reset the rotation finding process
-        if (sum((1-is_matched)%matchings) == -1*sum(1-is_matched)) {
-            current_agent = -1;
-        } else {
-            // otherwise, we just cut off the 'tail' when we removed the rotation, and the body
-            // can be used to find a new rotation
-            // in this case, set current_agent to be the last agent in the head, i.e., the agent who we
-            // matched to matchings(matchings(current_agent)), but who was not actually matched.
-            for (uword i = 0; i < N; ++i) {
-                if (matchings(i) == matchings(current_agent) && is_matched(i) == 0) {
-                    current_agent = i;
-                    break;
+    uvec coalition;
+    for (uword i = 0; i < N; i++) {
+        if (strict_edge(i) == NULL_VAL) continue;
+
+        // close the cycle with a breadth-first search from i's strictly
+        // preferred house back to i within their component
+        const uword j = pref(strict_edge(i), i);
+        uvec parent(N);
+        parent.fill(NULL_VAL);
+        std::queue<uword> queue;
+        queue.push(j);
+        parent(j) = j;
+        while (parent(i) == NULL_VAL) {
+            const uword v = queue.front();
+            queue.pop();
+            for (uword k = 0; k <= partner_rank(v); k++) {
+                const uword w = pref(k, v);
+                if (component(w) == component(i) && parent(w) == NULL_VAL) {
+                    parent(w) = v;
+                    queue.push(w);
                 }
             }
         }
+
+        // walk back from i to j and reverse
+        std::vector<uword> cycle;
+        for (uword v = i; v != j; v = parent(v)) {
+            cycle.push_back(v);
+        }
+        cycle.push_back(j);
+        std::reverse(cycle.begin() + 1, cycle.end());
+        coalition = conv_to<uvec>::from(cycle);
+        break;
     }
 
-    return matchings;
+    return coalition;
 }
 
 //' Check if a one-sided matching for the top trading cycle algorithm is stable
 //'
+//' This function checks if a matching is in the core, i.e. if there is no
+//' coalition of agents who could all do at least as well, and at least one of
+//' them strictly better, by trading their houses among themselves.
+//'
 //' @param pref is a matrix with the preference order of all individuals in the
 //'   market. If there are \code{n} individuals, then this matrix will be of
 //'   dimension \code{n} by \code{n}. The \code{i,j}th element refers to
@@ -156,36 +315,37 @@ uvec cpp_wrapper_ttc(const umat pref) {
 //' @return true if the matching is stable, false otherwise
 //' @export
 // [[Rcpp::export]]
-bool cpp_wrapper_ttc_check_stability(umat pref, uvec matchings) {
-
-    // loop through everyone and check whether there's anyone else
-    // who they'd rather be with
-    for (uword i=0; i<pref.n_cols; i++) {
-        for (uword j=i; j<pref.n_cols; j++) {
-
-            // do i, j prefer to switch?
-            bool i_prefers = false;
-            bool j_prefers = false;
-
-            // i?
-            for (uword k=0; k<pref.n_rows; k++) {
-                if (pref(k, i) == matchings(i)) break;
-                if (pref(k, i) == j) i_prefers = true;
-            }
-
-            // j?
-            for (uword k=0; k<pref.n_rows; k++) {
-                if (pref(k, j) == matchings(j)) break;
-                if (pref(k, j) == i) j_prefers = true;
-            }
-
-            // do they both want to switch?
-            if (i_prefers && j_prefers) {
-                return false;
-            }
-        }
-    }
-
-    return true;
+bool cpp_wrapper_ttc_check_stability(SEXP pref, const uvec& matchings) {
+    return withMatrixView(pref, [&](const auto& prefView) {
+        return blockingCoalitionTTC(prefView, matchings).n_elem == 0;
+    });
+}
 
+//' Find a blocking coalition for a one-sided matching
+//'
+//' This function looks for a coalition of agents who could all do at least as
+//' well, and at least one of them strictly better, by trading their houses
+//' among themselves. It builds the graph in which every agent points to all
+//' houses that he likes at least as much as his allocation and searches for a
+//' strongly connected component that contains an edge to a strictly preferred
+//' house. Users should not call this function directly and instead use
+//' \code{\link{toptrading.blockingCoalition}}.
+//'
+//' @param pref is a matrix with the preference order of all individuals in the
+//'   market. If there are \code{n} individuals, then this matrix will be of
+//'   dimension \code{n} by \code{n}. The \code{i,j}th element refers to
+//'   \code{j}'s \code{i}th most favorite partner. Preference orders must be
+//'   specified using C++ indexing (starting at 0).
+//' @param matchings is a vector of length \code{n} corresponding to the
+//'   matchings being made (using C++ indexing).
+//' @return A vector with the agents in a blocking coalition (using C++
+//'   indexing), such that each agent would receive the house of the next agent
+//'   and the last agent would receive the house of the first agent. The vector
+//'   is empty if the matching is in the core.
+//' @export
+// [[Rcpp::export]]
+uvec cpp_wrapper_ttc_blocking_coalition(SEXP pref, const uvec& matchings) {
+    return withMatrixView(pref, [&](const auto& prefView) {
+        return blockingCoalitionTTC(prefView, matchings);
+    });
 }
@@ -18,9 +18,17 @@
 #ifndef toptradingcycle_h
 #define toptradingcycle_h
 
+#include <queue>
 #include "matchingR.h"
+#include "utils.h"
+#include <matchingR/toptradingcycle.h>
 
-uvec cpp_wrapper_ttc(const umat pref);
-bool cpp_wrapper_ttc_check_stability(umat pref, umat matchings);
+SEXP cpp_wrapper_ttc(SEXP pref);
+uvec cpp_wrapper_ttc_file(const std::string& file);
+umat cpp_wrapper_ttc_batch(const cube& utils);
+bool cpp_wrapper_ttc_check_stability(SEXP pref, const uvec& matchings);
+uvec cpp_wrapper_ttc_blocking_coalition(SEXP pref, const uvec& matchings);
+template <typename Pref>
+uvec blockingCoalitionTTC(const Pref& pref, const uvec& matchings);
 
 #endif
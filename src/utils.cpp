@@ -20,23 +20,36 @@
 
 // [[Rcpp::depends(RcppArmadillo)]]
 
+// Checks the arguments of sortIndex and sortIndexOneSided and returns the
+// number of indices to keep
+static uword sortLength(const mat& u, const int k) {
+    if (k < 0 || (uword) k > u.n_rows) {
+        stop("k must be between 0 and the number of rows of u.");
+    }
+    if (u.has_nan()) {
+        stop("u must not contain missing values.");
+    }
+    return k == 0 ? u.n_rows : k;
+}
+
 //' Sort indices of a matrix within a column
 //'
 //' Within each column of a matrix, this function returns the indices of each
-//' element in descending order
+//' element in descending order. Ties are broken in favor of the lower index.
+//' Columns are sorted in parallel.
 //'
 //' @param u is the input matrix with cardinal preferences
+//' @param k is the number of indices to return for each column. If \code{k}
+//'   is smaller than the number of rows of \code{u}, then only the indices of
+//'   the \code{k} largest elements of each column are found, which is faster
+//'   than sorting the entire column. The default (\code{0}) returns all
+//'   indices. The columns of the result can be used as truncated preference
+//'   lists, e.g. \code{asplit(sortIndex(u, k) + 1, 2)}.
 //' @return a matrix with sorted indices (the agents' ordinal preferences)
 //' @export
 // [[Rcpp::export]]
-umat sortIndex(const mat& u) {
-    int N = u.n_rows;
-    int M = u.n_cols;
-    umat sortedIdx(N,M);
-    for(int jX=0;jX<M;jX++) {
-        sortedIdx.col(jX) = sort_index(u.col(jX), "descend");
-    }
-    return sortedIdx;
+umat sortIndex(const mat& u, const int k = 0) {
+    return sortPreferences<uword>(u, sortLength(u, k), false);
 }
 
 //' Ranks elements with column of a matrix, assuming a one-sided market.
@@ -44,30 +57,28 @@ umat sortIndex(const mat& u) {
 //' Returns the rank of each element with each column of a matrix. So, if row 34
 //' is the highest number for column 3, then the first row of column 3 will be
 //' 34 -- unless it is column 34, in which case it will be 35, to adjust for the
-//' fact that this is a single-sided market.
+//' fact that this is a single-sided market. The adjustment is made while the
+//' sorted indices are written, and columns are sorted in parallel.
 //'
 //' @param u A matrix with agents' cardinal preferences. Column i is agent i's
 //'   preferences.
+//' @param k is the number of indices to return for each column. The default
+//'   (\code{0}) returns all indices. See \code{\link{sortIndex}}.
 //' @return a matrix with the agents' ordinal preferences
 //' @export
 // [[Rcpp::export]]
-umat sortIndexOneSided(const mat& u) {
-    uword N = u.n_rows;
-    uword M = u.n_cols;
-    umat sortedIdx(N,M);
-    for(uword jX=0;jX<M;jX++) {
-        sortedIdx.col(jX) = sort_index(u.col(jX), "descend");
-    }
-
-    for (uword iX=0;iX<M;iX++) {
-        for (uword iY=0;iY<N;iY++) {
-            if (sortedIdx(iY, iX) >= iX) {
-                ++sortedIdx(iY, iX);
-            }
-        }
-    }
+umat sortIndexOneSided(const mat& u, const int k = 0) {
+    return sortPreferences<uword>(u, sortLength(u, k), true);
+}
 
-    return sortedIdx;
+// Checks and converts preference orders for galeShapley.checkPreferences
+// [[Rcpp::export]]
+List readPreferenceOrder(const mat& pref) {
+    umat out;
+    const bool valid = readPreferences(pref, out, false);
+    return List::create(
+      _["valid"] = valid,
+      _["pref"] = out);
 }
 
 //' Rank elements within column of a matrix
@@ -79,14 +90,99 @@ umat sortIndexOneSided(const mat& u) {
 //' @return a rank matrix
 //' @export
 // [[Rcpp::export]]
-umat rankIndex(const umat& sortedIdx) {
-    int N = sortedIdx.n_rows;
-    int M = sortedIdx.n_cols;
-    umat rankedIdx(N,M);
-    for(int iX=0; iX<N; iX++) {
-        for(int jX=0; jX<M; jX++) {
-            rankedIdx.at(sortedIdx.at(iX,jX), jX) = iX;
+umat rankIndex(SEXP sortedIdx) {
+    return withMatrixView(sortedIdx, [](const auto& sorted) {
+        const uword N = sorted.n_rows;
+        const uword M = sorted.n_cols;
+        umat rankedIdx(N,M);
+        #pragma omp parallel for schedule(static)
+        for(uword jX=0; jX<M; jX++) {
+            for(uword iX=0; iX<N; iX++) {
+                rankedIdx.at(sorted.at(iX,jX), jX) = iX;
+            }
+        }
+        return rankedIdx;
+    });
+}
+
+//' Write preferences to a preference file
+//'
+//' Writes a matrix of preference orders (using C++ indexing) to a binary
+//' preference file. Users should not call this function directly and instead
+//' use \code{\link{preferenceFile.write}}.
+//'
+//' @param pref is a matrix with preference orders. Column \code{j} contains
+//'   the preference order of agent \code{j}.
+//' @param file is the path of the file.
+//' @param ranks is \code{TRUE} if the ranks that each agent assigns to the
+//'   agents on the other side should be stored instead of the preference
+//'   orders.
+//' @export
+// [[Rcpp::export]]
+void cpp_write_preference_file(SEXP pref, const std::string& file, const bool ranks) {
+    withMatrixView(pref, [&](const auto& p) {
+        // indices are stored with the narrowest type that holds every index
+        const uword n = std::max(p.n_rows, p.n_cols);
+        const uint32_t bytes = matchingR::preferenceIndexBytes(n);
+        const auto* x = p.colptr(0);
+        for (uword iX = 0; iX < p.n_elem; iX++) {
+            if (!(x[iX] >= 0 && static_cast<double>(x[iX]) <= n)) {
+                stop("Invalid preference matrix: Preferences must be indices of agents.");
+            }
+        }
+        if (bytes == 2) {
+            matchingR::writeDensePreferences<uint16_t>(file, p, ranks);
+        } else if (bytes == 4) {
+            matchingR::writeDensePreferences<uint32_t>(file, p, ranks);
+        } else {
+            matchingR::writeDensePreferences<uint64_t>(file, p, ranks);
         }
+    });
+}
+
+//' Write truncated preference lists to a preference file
+//'
+//' Writes preference lists in compressed sparse row format to a binary
+//' preference file. Users should not call this function directly and instead
+//' use \code{\link{preferenceFile.write}}.
+//'
+//' @param ptr is a vector with the offsets of the preference lists in
+//'   \code{idx}.
+//' @param idx is a vector with the concatenated preference lists (using C++
+//'   indexing).
+//' @param n is the number of agents on the other side of the market.
+//' @param file is the path of the file.
+//' @export
+// [[Rcpp::export]]
+void cpp_write_preference_file_sparse(const uvec& ptr, const uvec& idx, const uword n, const std::string& file) {
+    if (ptr.n_elem == 0 || ptr(ptr.n_elem - 1) != idx.n_elem || (idx.n_elem > 0 && idx.max() >= n)) {
+        stop("Invalid preference lists.");
     }
-    return rankedIdx;
+    const uint32_t bytes = matchingR::preferenceIndexBytes(std::max(n, (uword) ptr.n_elem - 1));
+    if (bytes == 2) {
+        matchingR::writeSparsePreferences<uint16_t>(file, ptr, idx, n);
+    } else if (bytes == 4) {
+        matchingR::writeSparsePreferences<uint32_t>(file, ptr, idx, n);
+    } else {
+        matchingR::writeSparsePreferences<uint64_t>(file, ptr, idx, n);
+    }
+}
+
+//' Read the header of a preference file
+//'
+//' @param file is the path of the file.
+//' @return A list with the header of the file. Users should not call this
+//'   function directly and instead use \code{\link{preferenceFile.info}}.
+//' @export
+// [[Rcpp::export]]
+List cpp_preference_file_info(const std::string& file) {
+    const matchingR::PreferenceFile pf(file);
+    const matchingR::PreferenceFileHeader& head = pf.header();
+    return List::create(
+      _["content"] = head.content == matchingR::RANKS ? "ranks" : "preferences",
+      _["layout"] = head.layout == matchingR::CSR ? "sparse" : "dense",
+      _["index.bytes"] = (int) head.index_bytes,
+      _["nrow"] = (double) head.n_rows,
+      _["ncol"] = (double) head.n_cols,
+      _["nnz"] = (double) head.nnz);
 }
@@ -18,8 +18,295 @@
 #ifndef utils_h
 #define utils_h
 
-umat sortIndex(const mat& u);
-bool checkStabilityRoommate(umat& pref, umat& matchings);
-umat rankIndex(const umat& sortedIdx);
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <utility>
+#include <vector>
+#include <matchingR/matrix.h>
+#include <matchingR/preffile.h>
+#include <matchingR/statistics.h>
+
+using matchingR::MatrixView;
+
+// Calls f with a view of the R matrix x. Integer and numeric matrices are read
+// in place; other types (e.g. logical matrices) are converted to numeric
+// first.
+template <typename F>
+auto withMatrixView(SEXP x, F f) -> decltype(f(std::declval< MatrixView<double> >())) {
+    if (TYPEOF(x) == INTSXP) {
+        return f(MatrixView<int>(INTEGER(x), Rf_nrows(x), Rf_ncols(x)));
+    }
+    if (TYPEOF(x) == REALSXP) {
+        return f(MatrixView<double>(REAL(x), Rf_nrows(x), Rf_ncols(x)));
+    }
+    const NumericVector y(x);
+    return f(MatrixView<double>(y.begin(), Rf_nrows(x), Rf_ncols(x)));
+}
+
+// Calls f with an Armadillo matrix that reads the numeric R matrix x in place.
+// Other types are converted to numeric first. Unlike withMatrixView, elements
+// are not read as indices, so that this works for cardinal utilities.
+template <typename F>
+auto withNumericMatrix(SEXP x, F f) -> decltype(f(std::declval<const mat&>())) {
+    const NumericVector y(x);
+    const mat u(const_cast<double*>(y.begin()), Rf_nrows(x), Rf_ncols(x), false, true);
+    return f(u);
+}
+
+// Calls f with an Armadillo matrix that reads the R matrix x in place and
+// keeps the values of its elements, so that it works for both preference
+// orders and cardinal utilities. Integer matrices are read as a Mat<int> and
+// all other types as in withNumericMatrix.
+template <typename F>
+auto withInputMatrix(SEXP x, F f) -> decltype(f(std::declval<const mat&>())) {
+    if (TYPEOF(x) == INTSXP) {
+        const Mat<int> u(INTEGER(x), Rf_nrows(x), Rf_ncols(x), false, true);
+        return f(u);
+    }
+    return withNumericMatrix(x, f);
+}
+
+// Returns true if the cardinal utilities u contain missing values.
+inline bool hasMissing(const mat& u) {
+    return u.has_nan();
+}
+
+inline bool hasMissing(const Mat<int>& u) {
+    return std::find(u.begin(), u.end(), NA_INTEGER) != u.end();
+}
+
+// Calls f with a value of the smallest unsigned integer type that can hold
+// every index up to and including n. Tables of indices of markets with fewer
+// than 65535 agents on each side then take a quarter of the memory that they
+// would take with uword.
+template <typename F>
+auto withIndexType(const uword n, F f) -> decltype(f(uword())) {
+    if (n <= std::numeric_limits<uint16_t>::max()) {
+        return f(uint16_t());
+    }
+    if (n <= std::numeric_limits<uint32_t>::max()) {
+        return f(uint32_t());
+    }
+    return f(uword());
+}
+
+// Returns true if every element of pref is below bound, so that preference
+// orders that were not validated (e.g. from a preference file) can be used to
+// index tables of that size.
+template <typename Pref>
+bool indicesBelow(const Pref& pref, const uword bound) {
+    for (uword j = 0; j < pref.n_cols; j++) {
+        for (uword i = 0; i < pref.n_rows; i++) {
+            if (pref(i, j) >= bound) {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+// Returns true if ptr holds the offsets of preference lists in compressed
+// sparse row format with nnz listed partners in total: ptr starts at 0, never
+// decreases, and ends at nnz. Only then can the lists be read and transposed
+// without reading or writing out of bounds.
+template <typename Ptr>
+bool validOffsets(const Ptr& ptr, const uword nnz) {
+    if (ptr.n_elem == 0 || ptr(0) != 0 || ptr(ptr.n_elem - 1) != nnz) {
+        return false;
+    }
+    for (uword n = 0; n + 1 < ptr.n_elem; n++) {
+        if (ptr(n + 1) < ptr(n)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Writes the indices of the k largest elements of the column u (of length N)
+// to out, in descending order. Ties are broken in favor of the lower index. If
+// shift is true, indices at or above skip are increased by one, which turns
+// positions in a column of a one-sided market into the indices of agents.
+template <typename T, typename Index>
+void sortColumn(const T* u, const uword N, const uword k, Index* out,
+                std::vector<uword>& idx, const bool shift = false, const uword skip = 0) {
+    idx.resize(N);
+    for (uword iX = 0; iX < N; iX++) {
+        idx[iX] = iX;
+    }
+
+    auto prefers = [u](const uword a, const uword b) {
+        return u[a] > u[b] || (u[a] == u[b] && a < b);
+    };
+    if (k < N) {
+        std::partial_sort(idx.begin(), idx.begin() + k, idx.end(), prefers);
+    } else {
+        std::sort(idx.begin(), idx.end(), prefers);
+    }
+
+    for (uword iX = 0; iX < k; iX++) {
+        out[iX] = shift && idx[iX] >= skip ? idx[iX] + 1 : idx[iX];
+    }
+}
+
+// Sorts all columns of u in parallel, keeping the first k indices of each. If
+// oneSided is true, the indices are adjusted for a one-sided market as in
+// sortIndexOneSided. u must not contain missing values. This function does
+// not call into R, so that it can be used in parallel code.
+template <typename Index, typename Utils>
+Mat<Index> sortPreferences(const Utils& u, const uword k, const bool oneSided) {
+    const uword N = u.n_rows;
+    const uword M = u.n_cols;
+
+    Mat<Index> sortedIdx(k, M);
+
+    #pragma omp parallel
+    {
+        std::vector<uword> idx;
+
+        #pragma omp for schedule(static)
+        for (uword jX = 0; jX < M; jX++) {
+            sortColumn(u.colptr(jX), N, k, sortedIdx.colptr(jX), idx, oneSided, jX);
+        }
+    }
+
+    return sortedIdx;
+}
+
+// Returns true if some column of the cardinal utilities u has ties. pref
+// holds the indices of each column of u sorted by utility (see
+// sortPreferences), so that equal utilities are next to each other.
+template <typename Utils, typename Index>
+bool hasTies(const Utils& u, const Mat<Index>& pref) {
+    for (uword j = 0; j < pref.n_cols; j++) {
+        for (uword i = 1; i < pref.n_rows; i++) {
+            if (u(pref(i - 1, j), j) == u(pref(i, j), j)) {
+                return true;
+            }
+        }
+    }
+    return false;
+}
+
+// Turns preference orders into ranks: element (i, j) of the result is the
+// position of agent i in column j of pref, which must list all agents.
+template <typename Index>
+Mat<Index> invertPreferences(const Mat<Index>& pref) {
+    Mat<Index> ranks(pref.n_rows, pref.n_cols);
+
+    #pragma omp parallel for schedule(static)
+    for (uword jX = 0; jX < pref.n_cols; jX++) {
+        for (uword iX = 0; iX < pref.n_rows; iX++) {
+            ranks(pref(iX, jX), jX) = iX;
+        }
+    }
+
+    return ranks;
+}
+
+// Reads preference orders that use either R indexing (starting at 1) or C++
+// indexing (starting at 0) in one pass. If ranks is false, out contains the
+// preference orders in C++ indexing. If ranks is true, out(i, j) contains the
+// position of i in j's preferences instead. Returns false if some column is
+// not a permutation of all agents, or if the columns mix R and C++ indexing.
+// This function does not call into R.
+template <typename Pref, typename Index>
+bool readPreferences(const Pref& pref, Mat<Index>& out, const bool ranks) {
+    const uword N = pref.n_rows;
+    const uword M = pref.n_cols;
+
+    out.set_size(N, M);
+    if (pref.n_elem == 0) {
+        return true;
+    }
+
+    // the smallest index tells us whether R or C++ indexing is used
+    const double base = pref.min();
+    if (base != 0 && base != 1) {
+        return false;
+    }
+
+    bool valid = true;
+
+    #pragma omp parallel reduction(&&:valid)
+    {
+        // seen[i] == jX + 1 if agent i has already been listed by jX
+        std::vector<uword> seen(N, 0);
+
+        #pragma omp for schedule(static)
+        for (uword jX = 0; jX < M; jX++) {
+            for (uword iX = 0; iX < N; iX++) {
+                const double p = pref(iX, jX) - base;
+                if (!(p >= 0 && p < N) || p != std::floor(p) || seen[(uword) p] == jX + 1) {
+                    valid = false;
+                    break;
+                }
+                const uword agent = (uword) p;
+                seen[agent] = jX + 1;
+                if (ranks) {
+                    out(agent, jX) = iX;
+                } else {
+                    out(iX, jX) = agent;
+                }
+            }
+        }
+    }
+
+    return valid;
+}
+
+// Turns the statistics of a run into an R list (see matchingR/statistics.h).
+// The list is empty unless the package is compiled with MATCHINGR_STATISTICS.
+inline List statisticsList(const matchingR::Statistics& statistics) {
+#ifdef MATCHINGR_STATISTICS
+    NumericVector time(statistics.phases.size());
+    CharacterVector phases(statistics.phases.size());
+    for (uword pX = 0; pX < statistics.phases.size(); pX++) {
+        time[pX] = statistics.phases[pX].second;
+        phases[pX] = statistics.phases[pX].first;
+    }
+    time.attr("names") = phases;
+
+    return List::create(
+      _["proposals"]        = statistics.proposals,
+      _["rejections"]       = statistics.rejections,
+      _["max.queue.length"] = statistics.maxQueueLength,
+      _["retries"]          = statistics.retries,
+      _["rotations"]        = statistics.rotations,
+      _["cycle.lengths"]    = statistics.cycleLengths,
+      _["time"]             = time);
+#else
+    (void) statistics;
+    return List::create();
+#endif
+}
+
+// Adds the statistics of a run to its result as the element "statistics" if
+// the package is compiled with MATCHINGR_STATISTICS. Otherwise the result is
+// left as it is.
+inline List addStatistics(List result, const matchingR::Statistics& statistics) {
+    if (matchingR::Statistics::enabled) {
+        result.push_back(statisticsList(statistics), "statistics");
+    }
+    return result;
+}
+
+// Returns a vector with the statistics of a run as the attribute
+// "statistics" if the package is compiled with MATCHINGR_STATISTICS.
+inline SEXP addStatistics(const uvec& result, const matchingR::Statistics& statistics) {
+    RObject out = wrap(result);
+    if (matchingR::Statistics::enabled) {
+        out.attr("statistics") = statisticsList(statistics);
+    }
+    return out;
+}
+
+umat sortIndex(const mat& u, const int k);
+umat sortIndexOneSided(const mat& u, const int k);
+umat rankIndex(SEXP sortedIdx);
+void cpp_write_preference_file(SEXP pref, const std::string& file, const bool ranks);
+void cpp_write_preference_file_sparse(const uvec& ptr, const uvec& idx, const uword n, const std::string& file);
+List cpp_preference_file_info(const std::string& file);
 
 #endif